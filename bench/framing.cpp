@@ -0,0 +1,171 @@
+// Framing benchmark: the interleaved filebuf / memmove / de-interleave
+// loop that runPlugin used to run, against BlockFramer.
+//
+// Not part of the package build. From the package root:
+//
+//   g++ -O2 -std=c++11 -Isrc bench/framing.cpp -o framing && ./framing
+//
+// For each block/step/channel combination it checks that both paths
+// produce identical blocks, then reports the time per input frame and
+// the number of float stores per input sample made by each.
+
+#include "BlockFramer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Synthetic planar source; counts the stores it makes
+struct SyntheticSource {
+    SyntheticSource(int channels, int64_t frames) :
+        channels(channels), frames(frames), position(0), stores(0) {}
+
+    int64_t read(float *const *dest, int64_t n) {
+        n = std::max<int64_t>(0, std::min(n, frames - position));
+        for (int c = 0; c < channels; ++c) {
+            for (int64_t i = 0; i < n; ++i) {
+                dest[c][i] = sample(c, position + i);
+            }
+        }
+        stores += n * channels;
+        position += n;
+        return n;
+    }
+
+    static float sample(int c, int64_t i) {
+        return float((i * 7 + c * 13) % 101) / 101.f;
+    }
+
+    int channels;
+    int64_t frames;
+    int64_t position;
+    int64_t stores;
+};
+
+// The framing loop as it was in runPlugin, reduced to its copies
+template <typename Consumer>
+static int64_t legacyFraming(int channels, int64_t frames, int blockSize,
+                             int stepSize, Consumer consume)
+{
+    int overlapSize = blockSize - stepSize;
+    int finalStepsRemaining = std::max(1, (blockSize / stepSize) - 1);
+    std::unique_ptr<float[]> filebuf(new float[blockSize * channels]);
+    std::vector<std::unique_ptr<float[]>> plugbuf(channels);
+    std::vector<float *> raw(channels);
+    for (int c = 0; c < channels; ++c) {
+        plugbuf[c].reset(new float[blockSize + 2]);
+        raw[c] = plugbuf[c].get();
+    }
+    int64_t stores = 0, samplesRead = 0, currentStep = 0;
+
+    do {
+        int64_t count;
+        if (blockSize == stepSize || currentStep == 0) {
+            int64_t toRead = std::max<int64_t>(0, std::min<int64_t>(blockSize, frames - samplesRead));
+            for (int64_t i = 0; i < toRead; ++i)
+                for (int c = 0; c < channels; ++c)
+                    filebuf[i * channels + c] = SyntheticSource::sample(c, samplesRead + i);
+            std::fill(filebuf.get() + toRead * channels, filebuf.get() + blockSize * channels, 0.f);
+            stores += int64_t(blockSize) * channels;
+            count = toRead;
+            samplesRead += count;
+            if (count != blockSize) --finalStepsRemaining;
+        } else {
+            memmove(filebuf.get(), filebuf.get() + stepSize * channels,
+                    overlapSize * channels * sizeof(float));
+            int64_t toRead = std::max<int64_t>(0, std::min<int64_t>(stepSize, frames - samplesRead));
+            for (int64_t i = 0; i < toRead; ++i)
+                for (int c = 0; c < channels; ++c)
+                    filebuf[(overlapSize + i) * channels + c] = SyntheticSource::sample(c, samplesRead + i);
+            std::fill(filebuf.get() + (overlapSize + toRead) * channels,
+                      filebuf.get() + blockSize * channels, 0.f);
+            stores += int64_t(overlapSize + stepSize) * channels;
+            count = overlapSize + toRead;
+            samplesRead += stepSize;
+            if (toRead != stepSize) --finalStepsRemaining;
+        }
+        for (int c = 0; c < channels; ++c) {
+            int64_t j = 0;
+            for (; j < count; ++j) plugbuf[c][j] = filebuf[j * channels + c];
+            for (; j < blockSize; ++j) plugbuf[c][j] = 0.f;
+        }
+        stores += int64_t(blockSize) * channels;
+        consume(raw.data(), currentStep * stepSize);
+        ++currentStep;
+    } while (finalStepsRemaining > 0);
+
+    return stores;
+}
+
+static double seconds(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main()
+{
+    const int64_t frames = 44100 * 60 * 5 + 333;
+    const int configs[][3] = {
+        // blockSize, stepSize, channels
+        { 1024, 1024, 1 }, { 1024, 512, 1 }, { 2048, 256, 1 },
+        { 2048, 256, 2 }, { 4096, 512, 4 }, { 16384, 2048, 2 },
+    };
+    bool ok = true;
+
+    std::printf("%6s %6s %3s | %12s %12s | %10s %10s\n", "block", "step", "ch",
+                "legacy ns/f", "framer ns/f", "legacy st", "framer st");
+
+    for (const auto &cfg : configs) {
+        const int blockSize = cfg[0], stepSize = cfg[1], channels = cfg[2];
+
+        // Correctness: identical blocks at identical positions
+        std::vector<std::vector<float>> expected;
+        std::vector<int64_t> expectedStarts;
+        legacyFraming(channels, frames / 50, blockSize, stepSize,
+                      [&](const float *const *b, int64_t start) {
+                          for (int c = 0; c < channels; ++c)
+                              expected.push_back(std::vector<float>(b[c], b[c] + blockSize));
+                          expectedStarts.push_back(start);
+                      });
+        {
+            SyntheticSource source(channels, frames / 50);
+            BlockFramer framer(channels, blockSize, stepSize);
+            size_t n = 0;
+            while (framer.next(source) >= 0) {
+                if (n >= expectedStarts.size() || framer.blockStart() != expectedStarts[n]) ok = false;
+                for (int c = 0; ok && c < channels; ++c) {
+                    if (std::memcmp(framer.block()[c], expected[n * channels + c].data(),
+                                    blockSize * sizeof(float)) != 0) ok = false;
+                }
+                ++n;
+            }
+            if (n != expectedStarts.size()) ok = false;
+        }
+
+        // Timing, with a trivial consumer so the blocks are not dead
+        volatile float sink = 0.f;
+        auto t0 = std::chrono::steady_clock::now();
+        int64_t legacyStores = legacyFraming(channels, frames, blockSize, stepSize,
+                                             [&](const float *const *b, int64_t) { sink = sink + b[0][0]; });
+        double legacyTime = seconds(t0);
+
+        t0 = std::chrono::steady_clock::now();
+        SyntheticSource source(channels, frames);
+        BlockFramer framer(channels, blockSize, stepSize);
+        while (framer.next(source) >= 0) sink = sink + framer.block()[0][0];
+        double framerTime = seconds(t0);
+        int64_t framerStores = source.stores + framer.framesMoved() * channels;
+
+        std::printf("%6d %6d %3d | %12.2f %12.2f | %10.2f %10.2f\n",
+                    blockSize, stepSize, channels,
+                    legacyTime * 1e9 / frames, framerTime * 1e9 / frames,
+                    double(legacyStores) / (frames * channels),
+                    double(framerStores) / (frames * channels));
+    }
+
+    std::printf("%s\n", ok ? "framing output identical" : "FRAMING OUTPUT DIFFERS");
+    return ok ? 0 : 1;
+}
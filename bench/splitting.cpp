@@ -0,0 +1,149 @@
+// Channel splitting benchmark: the runtime-stride de-interleave loop that
+// SimpleWavReader::readPlanar() used for every multichannel file, against
+// the splitter SampleConverter picks for the channel count.
+//
+// Not part of the package build. From the package root:
+//
+//   g++ -O2 -std=c++11 -Isrc bench/splitting.cpp -o splitting && ./splitting
+//
+// For each encoding/channel combination it converts the same interleaved
+// data both ways, in the scratch-sized chunks readPlanar() uses, checks
+// that the channel buffers are identical, then reports the time per
+// input sample for the whole read (conversion and split) and for the
+// split alone.
+
+#include "SampleConverter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// The de-interleave as it was in readPlanar()
+static void legacySplit(const float *in, float *const *out, int channels, int64_t frames)
+{
+    for (int c = 0; c < channels; ++c) {
+        const float *src = in + c;
+        float *dest = out[c];
+        for (int64_t i = 0; i < frames; ++i) {
+            dest[i] = src[i * channels];
+        }
+    }
+}
+
+// readPlanar()'s conversion loop, with the split passed in
+static void convertPlanar(SampleConverter::Kernel kernel, SampleConverter::Splitter split,
+                          const unsigned char *raw, int frameBytes, int channels,
+                          std::vector<float> &scratch, std::vector<float *> &dest,
+                          float *const *out, int64_t n)
+{
+    const int64_t chunk = std::max<int64_t>(1, 4096 / channels);
+    scratch.resize(chunk * channels);
+    for (int64_t done = 0; done < n; done += chunk) {
+        const int64_t count = std::min(chunk, n - done);
+        kernel(raw + done * frameBytes, scratch.data(), count * channels);
+        for (int c = 0; c < channels; ++c) dest[c] = out[c] + done;
+        split(scratch.data(), dest.data(), channels, count);
+    }
+}
+
+static double seconds(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main()
+{
+    const int64_t frames = 65536 + 3;
+    const int repeats = 500;
+    const struct { const char *name; int format, bits; } encodings[] = {
+        { "int16", 1, 16 }, { "int24", 1, 24 }, { "float32", 3, 32 },
+    };
+    const int channelCounts[] = { 2, 3, 6 };
+    bool ok = true;
+
+    std::printf("%-8s %3s | %12s %12s | %12s %12s\n", "format", "ch",
+                "legacy ns/s", "split ns/s", "legacy split", "split only");
+
+    for (const auto &e : encodings) {
+        SampleConverter::Encoding encoding = SampleConverter::Int16;
+        SampleConverter::encoding(e.format, e.bits, encoding);
+        const SampleConverter::Kernel kernel = SampleConverter::kernel(encoding);
+
+        for (int channels : channelCounts) {
+            const int frameBytes = channels * e.bits / 8;
+            const int64_t samples = frames * channels;
+            std::vector<unsigned char> raw(frames * frameBytes);
+            for (size_t i = 0; i < raw.size(); ++i) raw[i] = (unsigned char)((i * 37 + i / 7) & 0xff);
+            if (e.format == 3) {
+                // Keep the float data finite, so that memcmp is a fair test
+                for (int64_t i = 0; i < samples; ++i) {
+                    float v = float((i * 7) % 101) / 101.f;
+                    std::memcpy(&raw[i * 4], &v, 4);
+                }
+            }
+
+            std::vector<std::vector<float>> expected(channels, std::vector<float>(frames));
+            std::vector<std::vector<float>> actual(channels, std::vector<float>(frames));
+            std::vector<float *> expectedOut(channels), actualOut(channels), dest(channels);
+            for (int c = 0; c < channels; ++c) {
+                expectedOut[c] = expected[c].data();
+                actualOut[c] = actual[c].data();
+            }
+            std::vector<float> scratch;
+            const SampleConverter::Splitter split = SampleConverter::splitter(channels);
+
+            // Correctness: identical channel buffers
+            convertPlanar(kernel, legacySplit, raw.data(), frameBytes, channels,
+                          scratch, dest, expectedOut.data(), frames);
+            convertPlanar(kernel, split, raw.data(), frameBytes, channels,
+                          scratch, dest, actualOut.data(), frames);
+            if (expected != actual) ok = false;
+
+            // Timing of the whole read, then of the split over one chunk
+            volatile float sink = 0.f;
+            auto t0 = std::chrono::steady_clock::now();
+            for (int r = 0; r < repeats; ++r) {
+                convertPlanar(kernel, legacySplit, raw.data(), frameBytes, channels,
+                              scratch, dest, expectedOut.data(), frames);
+                sink = sink + expected[0][r];
+            }
+            double legacyTime = seconds(t0);
+
+            t0 = std::chrono::steady_clock::now();
+            for (int r = 0; r < repeats; ++r) {
+                convertPlanar(kernel, split, raw.data(), frameBytes, channels,
+                              scratch, dest, actualOut.data(), frames);
+                sink = sink + actual[0][r];
+            }
+            double splitTime = seconds(t0);
+
+            const int64_t chunk = 4096 / channels;
+            const int chunkRepeats = int(repeats * (frames / chunk));
+            kernel(raw.data(), scratch.data(), chunk * channels);
+            t0 = std::chrono::steady_clock::now();
+            for (int r = 0; r < chunkRepeats; ++r) {
+                legacySplit(scratch.data(), expectedOut.data(), channels, chunk);
+                sink = sink + expected[0][r % chunk];
+            }
+            double legacySplitTime = seconds(t0);
+
+            t0 = std::chrono::steady_clock::now();
+            for (int r = 0; r < chunkRepeats; ++r) {
+                split(scratch.data(), actualOut.data(), channels, chunk);
+                sink = sink + actual[0][r % chunk];
+            }
+            double splitOnlyTime = seconds(t0);
+
+            const double total = double(samples) * repeats;
+            const double chunkTotal = double(chunk * channels) * chunkRepeats;
+            std::printf("%-8s %3d | %12.3f %12.3f | %12.3f %12.3f\n", e.name, channels,
+                        legacyTime * 1e9 / total, splitTime * 1e9 / total,
+                        legacySplitTime * 1e9 / chunkTotal, splitOnlyTime * 1e9 / chunkTotal);
+        }
+    }
+
+    std::printf("%s\n", ok ? "split output identical" : "SPLIT OUTPUT DIFFERS");
+    return ok ? 0 : 1;
+}
@@ -107,11 +107,21 @@ public:
 
     FeatureSet getRemainingFeatures();
 
+    /**
+     * Restrict the features returned by process() and
+     * getRemainingFeatures() to the outputs whose index is set in
+     * wanted. Features of other outputs are released by the plugin
+     * without being copied out of it. An empty vector (the default)
+     * returns every output.
+     */
+    void setOutputFilter(const std::vector<bool> &wanted);
+
 protected:
     void convertFeatures(VampFeatureList *, FeatureSet &);
 
     const VampPluginDescriptor *m_descriptor;
     VampPluginHandle m_handle;
+    std::vector<bool> m_outputFilter;
 };
 
 }
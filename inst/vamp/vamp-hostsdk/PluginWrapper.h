@@ -114,6 +114,10 @@ public:
      * it would be hard to do so without knowing the order of the
      * wrappers.  This function therefore gives direct access to the
      * wrapper of a particular type.
+     *
+     * If no wrapper matches but the innermost plugin is itself of
+     * type WrapperType, that plugin is returned; this is how a host
+     * reaches the PluginHostAdapter at the bottom of the stack.
      */
     template <typename WrapperType>
     WrapperType *getWrapper() {
@@ -121,7 +125,7 @@ public:
         if (w) return w;
         PluginWrapper *pw = dynamic_cast<PluginWrapper *>(m_plugin);
         if (pw) return pw->getWrapper<WrapperType>();
-        return 0;
+        return dynamic_cast<WrapperType *>(m_plugin);
     }
 
     /**
@@ -0,0 +1,319 @@
+#ifndef AUDIO_CACHE_H
+#define AUDIO_CACHE_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "AudioSource.h"
+
+// Decoded audio held in memory, one float buffer per channel
+struct DecodedAudio {
+    int sampleRate;
+    int64_t frames;
+    std::vector<std::vector<float> > channels;
+
+    DecodedAudio() : sampleRate(0), frames(0) {}
+
+    size_t bytes() const {
+        return channels.size() * size_t(frames) * sizeof(float);
+    }
+};
+
+// An in-process cache of decoded audio files, shared by every analysis
+// in the session, so running several plugins over the same file one
+// after another decodes it only once.
+//
+// Files are identified by path, size and modification time, so a file
+// that is rewritten is decoded afresh. The least recently used files are
+// dropped once the decoded audio exceeds the byte budget, which is zero,
+// disabling the cache, until set. Audio still being analysed stays in
+// memory until the analysis finishes, even if dropped from the cache.
+//
+// All members are safe to call from any thread.
+class AudioCache {
+public:
+    struct Key {
+        std::string path;
+        uint64_t size;
+        int64_t mtime; // nanoseconds where the platform records them
+        bool operator<(const Key &other) const {
+            if (path != other.path) return path < other.path;
+            if (size != other.size) return size < other.size;
+            return mtime < other.mtime;
+        }
+    };
+
+    struct Stats {
+        size_t budget;
+        size_t bytes;
+        size_t files;
+        uint64_t hits;
+        uint64_t misses;
+    };
+
+    // The cache shared by the whole session
+    static AudioCache &instance() {
+        static AudioCache cache;
+        return cache;
+    }
+
+    // Identify the file at path as it is now; false if it cannot be found
+    static bool fileKey(const std::string &path, Key &key) {
+#ifdef _WIN32
+        struct _stat64 st;
+        if (_stat64(path.c_str(), &st) != 0) return false;
+        key.mtime = int64_t(st.st_mtime) * 1000000000;
+#else
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) return false;
+#if defined(__APPLE__)
+        key.mtime = int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+        key.mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+#endif
+        key.path = path;
+        key.size = uint64_t(st.st_size);
+        return true;
+    }
+
+    size_t budget() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_budget;
+    }
+
+    // Set the byte budget, dropping files as needed to fit it
+    void setBudget(size_t bytes) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_budget = bytes;
+        evict(0);
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.clear();
+        m_index.clear();
+        m_bytes = 0;
+    }
+
+    // The cached audio of a file, or null, counting a hit or a miss
+    std::shared_ptr<const DecodedAudio> find(const Key &key) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Index::iterator it = m_index.find(key);
+        if (it == m_index.end()) {
+            ++m_misses;
+            return nullptr;
+        }
+        ++m_hits;
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return it->second->audio;
+    }
+
+    // Add a file, as the most recently used, if it fits the budget
+    void insert(const Key &key, std::shared_ptr<const DecodedAudio> audio) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const size_t bytes = audio->bytes();
+        if (bytes > m_budget || m_index.find(key) != m_index.end()) return;
+        // Older versions of the file will never be looked up again
+        for (Index::iterator it = m_index.begin(); it != m_index.end(); ) {
+            if (it->first.path == key.path) {
+                m_bytes -= it->second->audio->bytes();
+                m_entries.erase(it->second);
+                m_index.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+        evict(bytes);
+        Entry entry;
+        entry.key = key;
+        entry.audio = audio;
+        m_entries.push_front(entry);
+        m_index[key] = m_entries.begin();
+        m_bytes += bytes;
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stats s;
+        s.budget = m_budget;
+        s.bytes = m_bytes;
+        s.files = m_entries.size();
+        s.hits = m_hits;
+        s.misses = m_misses;
+        return s;
+    }
+
+private:
+    struct Entry {
+        Key key;
+        std::shared_ptr<const DecodedAudio> audio;
+    };
+    typedef std::list<Entry> Entries;
+    typedef std::map<Key, Entries::iterator> Index;
+
+    mutable std::mutex m_mutex;
+    Entries m_entries; // most recently used first
+    Index m_index;
+    size_t m_budget;
+    size_t m_bytes;
+    uint64_t m_hits;
+    uint64_t m_misses;
+
+    AudioCache() : m_budget(0), m_bytes(0), m_hits(0), m_misses(0) {}
+    AudioCache(const AudioCache &);
+    AudioCache &operator=(const AudioCache &);
+
+    // Drop least recently used files until another incoming bytes fit
+    void evict(size_t incoming) {
+        while (!m_entries.empty() && m_bytes + incoming > m_budget) {
+            m_bytes -= m_entries.back().audio->bytes();
+            m_index.erase(m_entries.back().key);
+            m_entries.pop_back();
+        }
+    }
+};
+
+// Audio decoded into memory, such as a file from the AudioCache. Blocks
+// are handed to plugins in place through view().
+class MemorySource : public AudioSource {
+public:
+    explicit MemorySource(std::shared_ptr<const DecodedAudio> audio) :
+        m_audio(audio), m_position(0) {}
+
+    int channels() const { return int(m_audio->channels.size()); }
+    int sampleRate() const { return m_audio->sampleRate; }
+    int64_t frames() const { return m_audio->frames; }
+
+    int64_t read(float *const *dest, int64_t n) {
+        n = std::max<int64_t>(0, std::min(n, m_audio->frames - m_position));
+        for (int c = 0; c < channels(); ++c) {
+            std::copy(m_audio->channels[c].begin() + m_position,
+                      m_audio->channels[c].begin() + m_position + n, dest[c]);
+        }
+        m_position += n;
+        return n;
+    }
+
+    bool seek(int64_t frame) {
+        if (frame < 0 || frame > m_audio->frames) return false;
+        m_position = frame;
+        return true;
+    }
+
+    int64_t position() const { return m_position; }
+
+    bool view(const float **channels, int64_t &frames) const {
+        for (int c = 0; c < this->channels(); ++c) {
+            channels[c] = m_audio->channels[c].data() + m_position;
+        }
+        frames = m_audio->frames - m_position;
+        return true;
+    }
+
+    std::unique_ptr<AudioSource> clone() const {
+        return std::unique_ptr<AudioSource>(new MemorySource(m_audio));
+    }
+
+private:
+    std::shared_ptr<const DecodedAudio> m_audio;
+    int64_t m_position;
+};
+
+// A file source that keeps a copy of everything read from it and, once
+// the whole file has been read from start to end, adds it to the
+// AudioCache. The file is decoded only once, by the analysis that
+// populates the cache; reading out of order, as region runs do, gives up
+// on the copy.
+class CachingSource : public AudioSource {
+public:
+    CachingSource(std::unique_ptr<AudioSource> source, const AudioCache::Key &key) :
+        m_source(std::move(source)), m_key(key), m_audio(new DecodedAudio) {
+        m_audio->sampleRate = m_source->sampleRate();
+        m_audio->channels.resize(m_source->channels());
+    }
+
+    int channels() const { return m_source->channels(); }
+    int sampleRate() const { return m_source->sampleRate(); }
+    int64_t frames() const { return m_source->frames(); }
+
+    int64_t read(float *const *dest, int64_t n) {
+        const int64_t from = m_source->position();
+        const int64_t got = m_source->read(dest, n);
+        if (m_audio && from == m_audio->frames) {
+            // The copy is only sized once a read from the start shows
+            // that it may be completed
+            if (from == 0) {
+                for (size_t c = 0; c < m_audio->channels.size(); ++c) {
+                    m_audio->channels[c].reserve(size_t(frames()));
+                }
+            }
+            for (size_t c = 0; c < m_audio->channels.size(); ++c) {
+                m_audio->channels[c].insert(m_audio->channels[c].end(), dest[c], dest[c] + got);
+            }
+            m_audio->frames += got;
+            if (m_audio->frames == frames()) {
+                AudioCache::instance().insert(m_key, m_audio);
+                m_audio.reset();
+            }
+        } else {
+            m_audio.reset();
+        }
+        return got;
+    }
+
+    bool seek(int64_t frame) {
+        if (m_audio && frame != m_audio->frames) m_audio.reset();
+        return m_source->seek(frame);
+    }
+
+    int64_t position() const { return m_source->position(); }
+
+    // Sources read in place never go through read(), so are not cached;
+    // openCachedAudioFile() does not wrap them in the first place
+    bool view(const float **channels, int64_t &frames) const {
+        return m_source->view(channels, frames);
+    }
+
+    std::unique_ptr<AudioSource> clone() const { return m_source->clone(); }
+
+private:
+    std::unique_ptr<AudioSource> m_source;
+    AudioCache::Key m_key;
+    std::shared_ptr<DecodedAudio> m_audio; // null once given up or cached
+};
+
+// As openAudioFile(), but served from the AudioCache where the file is
+// cached, and adding it to the cache as it is read where it fits. Files
+// whose samples can be read in place, such as mapped mono float WAV
+// files, are never decoded, so are left out of the cache altogether.
+inline std::unique_ptr<AudioSource> openCachedAudioFile(const std::string &filename,
+                                                        std::string &error) {
+    AudioCache &cache = AudioCache::instance();
+    AudioCache::Key key;
+    if (cache.budget() == 0 || !AudioCache::fileKey(filename, key)) {
+        return openAudioFile(filename, error);
+    }
+    std::unique_ptr<AudioSource> source = openAudioFile(filename, error);
+    if (!source) return nullptr;
+    std::vector<const float *> channels(source->channels());
+    int64_t viewFrames;
+    if (source->view(channels.data(), viewFrames)) return source;
+
+    std::shared_ptr<const DecodedAudio> audio = cache.find(key);
+    if (audio) return std::unique_ptr<AudioSource>(new MemorySource(audio));
+
+    const uint64_t bytes = uint64_t(source->frames()) * source->channels() * sizeof(float);
+    if (bytes > cache.budget()) return source;
+    return std::unique_ptr<AudioSource>(new CachingSource(std::move(source), key));
+}
+
+#endif
@@ -0,0 +1,312 @@
+#ifndef AUDIO_SOURCE_H
+#define AUDIO_SOURCE_H
+
+#include <string>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <fstream>
+#include <cstring>
+
+#include "SimpleWavReader.h"
+#include "FlacReader.h"
+
+// Sequential planar audio input for the framing loop.
+//
+// Implementations hold plain pointers and C++ streams only, never R
+// objects, so they stay valid and safe to read away from the R API.
+class AudioSource {
+public:
+    virtual ~AudioSource() {}
+
+    virtual int channels() const = 0;
+    virtual int sampleRate() const = 0;
+    virtual int64_t frames() const = 0;
+
+    // Write up to n frames into dest[channel], returning the number
+    // written; fewer than n only at the end of the input.
+    virtual int64_t read(float *const *dest, int64_t n) = 0;
+
+    // Make the next read() start at the given frame
+    virtual bool seek(int64_t frame) = 0;
+
+    // Frame the next read() starts at
+    virtual int64_t position() const = 0;
+
+    // If the frames from position() onwards are already in memory as one
+    // float array per channel, point channels[c] at the first of them,
+    // set frames to how many there are and return true. Blocks can then
+    // be handed to plugins in place instead of through read().
+    virtual bool view(const float **channels, int64_t &frames) const {
+        (void)channels;
+        (void)frames;
+        return false;
+    }
+
+    // An independent source over the same audio, positioned at the
+    // start, or null if one cannot be opened
+    virtual std::unique_ptr<AudioSource> clone() const = 0;
+};
+
+// Samples held in the left/right slots of a tuneR Wave object
+class WaveObjectSource : public AudioSource {
+public:
+    WaveObjectSource(const double *left, const double *right,
+                     int64_t frames, int sampleRate, double scale) :
+        m_left(left), m_right(right), m_frames(frames),
+        m_sampleRate(sampleRate), m_scale(scale), m_position(0) {}
+
+    int channels() const { return m_right ? 2 : 1; }
+    int sampleRate() const { return m_sampleRate; }
+    int64_t frames() const { return m_frames; }
+
+    int64_t read(float *const *dest, int64_t n) {
+        n = std::max<int64_t>(0, std::min(n, m_frames - m_position));
+        convert(m_left + m_position, dest[0], n);
+        if (m_right) convert(m_right + m_position, dest[1], n);
+        m_position += n;
+        return n;
+    }
+
+    bool seek(int64_t frame) {
+        if (frame < 0 || frame > m_frames) return false;
+        m_position = frame;
+        return true;
+    }
+
+    int64_t position() const { return m_position; }
+
+    std::unique_ptr<AudioSource> clone() const {
+        return std::unique_ptr<AudioSource>
+            (new WaveObjectSource(m_left, m_right, m_frames, m_sampleRate, m_scale));
+    }
+
+private:
+    const double *m_left;
+    const double *m_right;
+    int64_t m_frames;
+    int m_sampleRate;
+    double m_scale;
+    int64_t m_position;
+
+    void convert(const double *in, float *out, int64_t n) const {
+        for (int64_t i = 0; i < n; ++i) {
+            out[i] = in[i] * m_scale;
+        }
+    }
+};
+
+// A WAV file, decoded as it is read
+class WavFileSource : public AudioSource {
+public:
+    bool open(const std::string &filename) {
+        m_filename = filename;
+        return m_reader.open(filename);
+    }
+    const std::string &error() const { return m_reader.error(); }
+
+    int channels() const { return m_reader.header().channels; }
+    int sampleRate() const { return m_reader.header().sampleRate; }
+    int64_t frames() const { return m_reader.frames(); }
+
+    int64_t read(float *const *dest, int64_t n) {
+        return m_reader.readPlanar(dest, n);
+    }
+
+    bool seek(int64_t frame) { return m_reader.seek(frame); }
+
+    int64_t position() const { return m_reader.position(); }
+
+    bool view(const float **channels, int64_t &frames) const {
+        return m_reader.view(channels, frames);
+    }
+
+    std::unique_ptr<AudioSource> clone() const {
+        std::unique_ptr<WavFileSource> other(new WavFileSource);
+        if (!other->open(m_filename)) return nullptr;
+        return std::unique_ptr<AudioSource>(other.release());
+    }
+
+private:
+    std::string m_filename;
+    SimpleWavReader m_reader;
+};
+
+// A FLAC file, decoded a frame at a time as it is read
+class FlacFileSource : public AudioSource {
+public:
+    bool open(const std::string &filename) {
+        m_filename = filename;
+        return m_reader.open(filename);
+    }
+    const std::string &error() const { return m_reader.error(); }
+
+    int channels() const { return m_reader.channels(); }
+    int sampleRate() const { return m_reader.sampleRate(); }
+    int64_t frames() const { return m_reader.frames(); }
+
+    int64_t read(float *const *dest, int64_t n) {
+        return m_reader.readPlanar(dest, n);
+    }
+
+    bool seek(int64_t frame) { return m_reader.seek(frame); }
+
+    int64_t position() const { return m_reader.position(); }
+
+    std::unique_ptr<AudioSource> clone() const {
+        std::unique_ptr<FlacFileSource> other(new FlacFileSource);
+        if (!other->open(m_filename)) return nullptr;
+        return std::unique_ptr<AudioSource>(other.release());
+    }
+
+private:
+    std::string m_filename;
+    FlacReader m_reader;
+};
+
+// "FLAC" if the file at filename starts like a FLAC stream (possibly
+// after an ID3v2 tag, skipped as FlacReader skips it), "unknown" if it
+// has an ID3v2 tag that is not followed by one (an MP3, say), and "WAV"
+// otherwise
+inline std::string audioFileFormat(const std::string &filename) {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    unsigned char header[10] = { 0 };
+    in.read(reinterpret_cast<char *>(header), 4);
+    if (std::memcmp(header, "fLaC", 4) == 0) {
+        return "FLAC";
+    }
+    if (std::memcmp(header, "ID3", 3) != 0) {
+        return "WAV";
+    }
+    in.read(reinterpret_cast<char *>(header) + 4, 6);
+    uint32_t length = 0;
+    for (int i = 6; i < 10; ++i) length = (length << 7) | (header[i] & 0x7f);
+    char magic[4] = { 0, 0, 0, 0 };
+    in.seekg(10 + std::streamoff(length));
+    in.read(magic, 4);
+    if (in && std::strncmp(magic, "fLaC", 4) == 0) {
+        return "FLAC";
+    }
+    return "unknown";
+}
+
+// Open a WAV or FLAC file, told apart by their first bytes. On failure
+// returns null with the reason in error.
+inline std::unique_ptr<AudioSource> openAudioFile(const std::string &filename,
+                                                  std::string &error) {
+    const std::string format = audioFileFormat(filename);
+    if (format == "unknown") {
+        error = "Not a WAV or FLAC file (ID3 tag not followed by a FLAC stream)";
+        return nullptr;
+    }
+    if (format == "FLAC") {
+        std::unique_ptr<FlacFileSource> flac(new FlacFileSource);
+        if (!flac->open(filename)) {
+            error = flac->error();
+            return nullptr;
+        }
+        return std::unique_ptr<AudioSource>(flac.release());
+    }
+    std::unique_ptr<WavFileSource> wav(new WavFileSource);
+    if (!wav->open(filename)) {
+        error = wav->error();
+        return nullptr;
+    }
+    return std::unique_ptr<AudioSource>(wav.release());
+}
+
+// The properties of an audio file, from its headers alone
+struct AudioFileInfo {
+    std::string format; // "WAV", "FLAC" or "unknown"
+    std::string error;  // empty if the headers were read
+    int sampleRate;
+    int channels;
+    int bitsPerSample;
+    int64_t frames;
+    AudioFileInfo() : sampleRate(0), channels(0), bitsPerSample(0), frames(0) {}
+};
+
+// Read the headers of a WAV or FLAC file without mapping it or decoding
+// any audio; only the first few kilobytes of the file are read
+inline AudioFileInfo probeAudioFile(const std::string &filename) {
+    AudioFileInfo info;
+    info.format = audioFileFormat(filename);
+    if (info.format == "unknown") {
+        info.error = "Not a WAV or FLAC file (ID3 tag not followed by a FLAC stream)";
+        return info;
+    }
+    if (info.format == "FLAC") {
+        FlacReader reader;
+        if (!reader.open(filename, false)) {
+            info.error = reader.error();
+            return info;
+        }
+        info.sampleRate = reader.sampleRate();
+        info.channels = reader.channels();
+        info.bitsPerSample = reader.bitsPerSample();
+        info.frames = reader.frames();
+    } else {
+        SimpleWavReader reader;
+        if (!reader.open(filename, false)) {
+            info.error = reader.error();
+            return info;
+        }
+        info.sampleRate = int(reader.header().sampleRate);
+        info.channels = reader.header().channels;
+        info.bitsPerSample = reader.header().bitsPerSample;
+        info.frames = reader.frames();
+    }
+    return info;
+}
+
+// The frames [begin, end) of another source, presented as a source of
+// its own starting at frame 0. Reading starts with a seek in the
+// underlying source, so the frames before begin are never decoded.
+class RegionSource : public AudioSource {
+public:
+    RegionSource(std::unique_ptr<AudioSource> source, int64_t begin, int64_t end) :
+        m_source(std::move(source)), m_begin(begin), m_end(end), m_position(0) {}
+
+    int channels() const { return m_source->channels(); }
+    int sampleRate() const { return m_source->sampleRate(); }
+    int64_t frames() const { return m_end - m_begin; }
+
+    int64_t read(float *const *dest, int64_t n) {
+        n = std::max<int64_t>(0, std::min(n, frames() - m_position));
+        int64_t got = m_source->read(dest, n);
+        m_position += got;
+        return got;
+    }
+
+    bool seek(int64_t frame) {
+        if (frame < 0 || frame > frames()) return false;
+        if (!m_source->seek(m_begin + frame)) return false;
+        m_position = frame;
+        return true;
+    }
+
+    int64_t position() const { return m_position; }
+
+    // The underlying source is positioned at m_begin + m_position
+    bool view(const float **channels, int64_t &frames) const {
+        if (!m_source->view(channels, frames)) return false;
+        frames = std::min(frames, this->frames() - m_position);
+        return true;
+    }
+
+    std::unique_ptr<AudioSource> clone() const {
+        std::unique_ptr<AudioSource> inner = m_source->clone();
+        if (!inner) return nullptr;
+        std::unique_ptr<AudioSource> other(new RegionSource(std::move(inner), m_begin, m_end));
+        if (!other->seek(0)) return nullptr;
+        return other;
+    }
+
+private:
+    std::unique_ptr<AudioSource> m_source;
+    int64_t m_begin;
+    int64_t m_end;
+    int64_t m_position;
+};
+
+#endif
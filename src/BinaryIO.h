@@ -0,0 +1,95 @@
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <cstdint>
+
+// Native-order binary reads and writes for the package's own feature
+// files. Strings are a uint32 length and the bytes; columns are written
+// as one block, with their length stored separately by the caller.
+
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::ostream &out) : m_out(out) {}
+
+    void bytes(const void *p, size_t n) {
+        m_out.write(static_cast<const char *>(p), std::streamsize(n));
+    }
+
+    template <typename T>
+    void put(const T &v) { bytes(&v, sizeof(v)); }
+
+    void string(const std::string &s) {
+        put(uint32_t(s.size()));
+        bytes(s.data(), s.size());
+    }
+
+    template <typename T>
+    void column(const std::vector<T> &v) {
+        if (!v.empty()) bytes(v.data(), v.size() * sizeof(T));
+    }
+
+private:
+    std::ostream &m_out;
+};
+
+// Reads that fail, rather than allocate, when a count claims more bytes
+// than remain in the stream
+class BinaryReader {
+public:
+    // The stream must be open at its end (std::ios::ate), so its length
+    // is known; reading starts from the beginning
+    explicit BinaryReader(std::istream &in) : m_in(in) {
+        std::streamoff end = m_in.tellg();
+        m_length = end > 0 ? uint64_t(end) : 0;
+        m_remaining = m_length;
+        m_in.seekg(0);
+    }
+
+    uint64_t remaining() const { return m_remaining; }
+    uint64_t position() const { return m_length - m_remaining; }
+
+    // Continue reading from byte pos
+    bool seek(uint64_t pos) {
+        if (pos > m_length) return false;
+        m_in.clear();
+        m_in.seekg(std::streamoff(pos));
+        m_remaining = m_length - pos;
+        return bool(m_in);
+    }
+
+    bool bytes(void *p, uint64_t n) {
+        if (n > m_remaining) return false;
+        m_in.read(static_cast<char *>(p), std::streamsize(n));
+        m_remaining -= n;
+        return bool(m_in);
+    }
+
+    template <typename T>
+    bool get(T &v) { return bytes(&v, sizeof(v)); }
+
+    bool string(std::string &s) {
+        uint32_t n;
+        if (!get(n) || n > m_remaining) return false;
+        s.resize(n);
+        return n == 0 || bytes(&s[0], n);
+    }
+
+    // Replace the contents of v with the next n elements
+    template <typename T>
+    bool column(std::vector<T> &v, uint64_t n) {
+        if (n > m_remaining / sizeof(T)) return false;
+        v.resize(size_t(n));
+        return n == 0 || bytes(v.data(), n * sizeof(T));
+    }
+
+private:
+    std::istream &m_in;
+    uint64_t m_length;
+    uint64_t m_remaining;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef BLOCK_FRAMER_H
+#define BLOCK_FRAMER_H
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+// Splits a planar audio stream into overlapping blocks for one or more
+// plugins.
+//
+// Each channel is held in its own buffer, several blocks long. Samples
+// are decoded by the source straight into that buffer and the plugin is
+// handed pointers into it, so a sample is written once and never
+// de-interleaved. When the write position reaches the end of the buffer
+// the overlap still needed is moved back to the front; with the buffer
+// at four blocks long that costs one move of the overlap per three
+// blocks' worth of input, instead of the per-step memmove and
+// de-interleave copies of a single interleaved block buffer.
+//
+// Several cursors, each with its own block and step size, can share the
+// one buffer. next() always advances the cursor whose next block ends
+// earliest, so the input is decoded once and only the frames still
+// wanted by some cursor are kept.
+//
+// If the whole input is already in memory, setView() makes the framer
+// hand out pointers straight into it instead, copying only the final
+// blocks that run past the end and need zero padding.
+//
+// Blocks start at multiples of the step size and are zero-padded past
+// the end of the source. As in vamp-simple-host, framing continues until
+// max(1, blockSize / stepSize - 1) blocks have run past the end of the
+// input, so the tail is seen at every overlap position.
+//
+// Source must provide
+//   int64_t read(float *const *dest, int64_t n)
+// writing up to n planar frames into dest[channel] and returning the
+// number written (fewer only at end of input).
+class BlockFramer {
+public:
+    // A framer with no cursors; add them with addCursor()
+    explicit BlockFramer(int channels) :
+        m_channels(channels),
+        m_capacity(0),
+        m_buffers(channels),
+        m_pointers(channels),
+        m_dest(channels),
+        m_base(0),
+        m_end(0),
+        m_sourceEnd(std::numeric_limits<int64_t>::max()),
+        m_moved(0),
+        m_viewing(false)
+    { }
+
+    // A framer with the single cursor 0
+    BlockFramer(int channels, int blockSize, int stepSize) :
+        BlockFramer(channels)
+    {
+        addCursor(blockSize, stepSize);
+    }
+
+    // Add a cursor and return its index. All cursors must be added
+    // before the first call to next().
+    int addCursor(int blockSize, int stepSize) {
+        Cursor cursor;
+        cursor.blockSize = blockSize;
+        cursor.stepSize = stepSize;
+        cursor.start = 0;
+        cursor.blocks = 0;
+        cursor.finalStepsRemaining = std::max(1, (blockSize / stepSize) - 1);
+        m_cursors.push_back(cursor);
+
+        int capacity = std::max(blockSize * 4, blockSize + stepSize);
+        if (capacity > m_capacity) {
+            m_capacity = capacity;
+            // Two samples of slack past the last block, as plugbuf always had
+            for (int c = 0; c < m_channels; ++c) {
+                m_buffers[c].assign(m_capacity + 2, 0.0f);
+            }
+        }
+        return int(m_cursors.size()) - 1;
+    }
+
+    // Take the input from channels[c][0 .. frames) in place rather than
+    // reading it from the source. Must be called before the first call
+    // to next(); the arrays must outlive the framer.
+    void setView(const float *const *channels, int64_t frames) {
+        m_view.assign(channels, channels + m_channels);
+        m_sourceEnd = frames;
+        m_viewing = true;
+    }
+
+    // Move the cursor whose next block ends earliest on to that block,
+    // pulling whatever new input it needs from source, and return its
+    // index. Returns -1 once every cursor is complete. The block stays
+    // valid until the next call.
+    template <typename Source>
+    int next(Source &source) {
+        int index = -1;
+        int64_t end = 0;
+        for (size_t i = 0; i < m_cursors.size(); ++i) {
+            const Cursor &cursor = m_cursors[i];
+            if (cursor.finalStepsRemaining <= 0) continue;
+            int64_t e = nextStart(cursor) + cursor.blockSize;
+            if (index < 0 || e < end) {
+                index = int(i);
+                end = e;
+            }
+        }
+        if (index < 0) return -1;
+
+        Cursor &cursor = m_cursors[index];
+        if (!m_viewing) fill(source, end);
+        cursor.start = nextStart(cursor);
+        if (end > m_sourceEnd) --cursor.finalStepsRemaining;
+        ++cursor.blocks;
+        return index;
+    }
+
+    // Stop a cursor early; next() will not return it again
+    void finish(int cursor) { m_cursors[cursor].finalStepsRemaining = 0; }
+
+    // Per-channel pointers to the current block of a cursor
+    const float *const *block(int cursor = 0) {
+        if (m_viewing) return viewBlock(m_cursors[cursor]);
+        for (int c = 0; c < m_channels; ++c) {
+            m_pointers[c] = m_buffers[c].data() + (m_cursors[cursor].start - m_base);
+        }
+        return m_pointers.data();
+    }
+
+    // Frame index of the first sample of the current block
+    int64_t blockStart(int cursor = 0) const { return m_cursors[cursor].start; }
+
+    // Number of blocks returned so far
+    int64_t blockCount(int cursor = 0) const { return m_cursors[cursor].blocks; }
+
+    int blockSize(int cursor = 0) const { return m_cursors[cursor].blockSize; }
+    int stepSize(int cursor = 0) const { return m_cursors[cursor].stepSize; }
+
+    // Frames per channel moved while compacting the buffers
+    int64_t framesMoved() const { return m_moved; }
+
+private:
+    struct Cursor {
+        int blockSize;
+        int stepSize;
+        int64_t start;
+        int64_t blocks;
+        int finalStepsRemaining;
+    };
+
+    int m_channels;
+    int m_capacity;
+    std::vector<Cursor> m_cursors;
+    std::vector<std::vector<float>> m_buffers;
+    std::vector<const float *> m_pointers;
+    std::vector<float *> m_dest;
+    int64_t m_base;       // frame index held at m_buffers[c][0]
+    int64_t m_end;        // frame index one past the last buffered frame
+    int64_t m_sourceEnd;  // frame count of the source, once it is known
+    int64_t m_moved;
+    bool m_viewing;
+    std::vector<const float *> m_view;
+
+    static int64_t nextStart(const Cursor &cursor) {
+        return cursor.blocks > 0 ? cursor.start + cursor.stepSize : 0;
+    }
+
+    // Earliest frame any unfinished cursor will still ask for
+    int64_t firstWanted() const {
+        int64_t first = m_end;
+        for (size_t i = 0; i < m_cursors.size(); ++i) {
+            if (m_cursors[i].finalStepsRemaining <= 0) continue;
+            first = std::min(first, nextStart(m_cursors[i]));
+        }
+        return first;
+    }
+
+    // A block of the view, or a zero-padded copy of it if it runs past
+    // the end of the input
+    const float *const *viewBlock(const Cursor &cursor) {
+        int64_t available = m_sourceEnd - cursor.start;
+        for (int c = 0; c < m_channels; ++c) {
+            if (available >= cursor.blockSize) {
+                m_pointers[c] = m_view[c] + cursor.start;
+            } else {
+                float *buf = m_buffers[c].data();
+                int64_t n = std::max<int64_t>(0, available);
+                if (n > 0) std::memcpy(buf, m_view[c] + cursor.start, n * sizeof(float));
+                std::fill(buf + n, buf + cursor.blockSize, 0.0f);
+                m_pointers[c] = buf;
+            }
+        }
+        return m_pointers.data();
+    }
+
+    template <typename Source>
+    void fill(Source &source, int64_t upTo) {
+        if (upTo <= m_end) return;
+
+        if (upTo - m_base > m_capacity) {
+            int64_t first = std::max(m_base, firstWanted());
+            int64_t keep = m_end - first;
+            if (keep > 0) {
+                for (int c = 0; c < m_channels; ++c) {
+                    float *buf = m_buffers[c].data();
+                    std::memmove(buf, buf + (first - m_base), keep * sizeof(float));
+                }
+                m_moved += keep;
+            }
+            m_base = first;
+        }
+
+        int64_t wanted = upTo - m_end;
+        int64_t got = 0;
+        if (m_end < m_sourceEnd) {
+            for (int c = 0; c < m_channels; ++c) {
+                m_dest[c] = m_buffers[c].data() + (m_end - m_base);
+            }
+            got = source.read(m_dest.data(), wanted);
+            if (got < wanted) m_sourceEnd = m_end + got;
+        }
+        for (int c = 0; c < m_channels; ++c) {
+            float *buf = m_buffers[c].data() + (m_end - m_base);
+            std::fill(buf + got, buf + wanted, 0.0f);
+        }
+        m_end = upTo;
+    }
+};
+
+#endif
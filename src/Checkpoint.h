@@ -0,0 +1,90 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <string>
+#include <map>
+#include <fstream>
+#include <cstdint>
+
+#include "FeatureData.h"
+#include "FeatureCache.h"
+#include "BinaryIO.h"
+
+// Files holding the progress of a long runPlugin() call, so that it can
+// be resumed after the R session dies.
+//
+// A file is the magic "RVK1", a byte-order marker and the width of a
+// value offset, as in a cache file, then the fingerprint of the run, the
+// frame from which the run resumes, the frame it had reached when the
+// file was written, and the features timestamped before the resume
+// frame, laid out as in a cache file (see FeatureCache). Files are
+// replaced whole, through a temporary file, so a crash while writing one
+// leaves the previous one in place.
+class Checkpoint {
+public:
+    struct State {
+        std::string fingerprint;
+        int64_t resumeFrom;
+        int64_t position;
+        std::map<int, FeatureData> features; // as read by load()
+
+        State() : resumeFrom(0), position(0) {}
+    };
+
+    // Read the file at path into state, returning false if it is
+    // missing, truncated or not a checkpoint file
+    static bool load(const std::string &path, State &state) {
+        std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+        if (!in) return false;
+        BinaryReader r(in);
+
+        char magic[4];
+        uint32_t order, offsetSize;
+        if (!r.bytes(magic, 4) || std::string(magic, 4) != "RVK1" ||
+            !r.get(order) || order != FeatureCache::ByteOrder ||
+            !r.get(offsetSize) || offsetSize != sizeof(size_t)) {
+            return false;
+        }
+        State result;
+        if (!r.string(result.fingerprint) || !r.get(result.resumeFrom) ||
+            !r.get(result.position) || !FeatureCache::readFeatures(r, result.features)) {
+            return false;
+        }
+        std::swap(state.fingerprint, result.fingerprint);
+        state.resumeFrom = result.resumeFrom;
+        state.position = result.position;
+        state.features.swap(result.features);
+        return true;
+    }
+
+    // Write the fingerprint and positions of state to path, replacing any
+    // existing file, with the features of features timestamped before
+    // limit. These are a running plugin's own, stored without copying
+    // them. Returns false if the file could not be written.
+    static bool store(const std::string &path, const State &state,
+                      const std::map<int, FeatureData> &features, double limit) {
+        std::string temp = FeatureCache::temporaryPath(path);
+        {
+            std::ofstream out(temp.c_str(), std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+            BinaryWriter w(out);
+            w.bytes("RVK1", 4);
+            w.put(uint32_t(FeatureCache::ByteOrder));
+            w.put(uint32_t(sizeof(size_t)));
+            w.string(state.fingerprint);
+            w.put(int64_t(state.resumeFrom));
+            w.put(int64_t(state.position));
+            FeatureCache::writeFeatures(w, features, limit);
+            if (!FeatureCache::close(out, temp)) return false;
+        }
+        return FeatureCache::replace(temp, path);
+    }
+
+    // Whether a file exists at path
+    static bool exists(const std::string &path) {
+        std::ifstream in(path.c_str(), std::ios::binary);
+        return bool(in);
+    }
+};
+
+#endif
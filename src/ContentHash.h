@@ -0,0 +1,162 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+// Streaming 64-bit xxHash (XXH64). Fast and well distributed, but not
+// cryptographic: fine for naming cache entries, not for anything an
+// adversary chooses.
+class XXH64 {
+public:
+    explicit XXH64(uint64_t seed = 0) : m_seed(seed) { reset(); }
+
+    void reset() {
+        m_acc[0] = m_seed + P1 + P2;
+        m_acc[1] = m_seed + P2;
+        m_acc[2] = m_seed;
+        m_acc[3] = m_seed - P1;
+        m_total = 0;
+        m_buffered = 0;
+    }
+
+    void update(const void *data, size_t n) {
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        m_total += n;
+        if (m_buffered + n < 32) {
+            std::memcpy(m_buffer + m_buffered, p, n);
+            m_buffered += n;
+            return;
+        }
+        if (m_buffered > 0) {
+            size_t fill = 32 - m_buffered;
+            std::memcpy(m_buffer + m_buffered, p, fill);
+            stripe(m_buffer);
+            p += fill;
+            n -= fill;
+            m_buffered = 0;
+        }
+        for (; n >= 32; p += 32, n -= 32) stripe(p);
+        std::memcpy(m_buffer, p, n);
+        m_buffered = n;
+    }
+
+    uint64_t digest() const {
+        uint64_t h;
+        if (m_total >= 32) {
+            h = rotl(m_acc[0], 1) + rotl(m_acc[1], 7) + rotl(m_acc[2], 12) + rotl(m_acc[3], 18);
+            for (int i = 0; i < 4; ++i) {
+                h ^= round(0, m_acc[i]);
+                h = h * P1 + P4;
+            }
+        } else {
+            h = m_seed + P5;
+        }
+        h += m_total;
+
+        const unsigned char *p = m_buffer;
+        size_t n = m_buffered;
+        for (; n >= 8; p += 8, n -= 8) {
+            h ^= round(0, read64(p));
+            h = rotl(h, 27) * P1 + P4;
+        }
+        if (n >= 4) {
+            h ^= uint64_t(read32(p)) * P1;
+            h = rotl(h, 23) * P2 + P3;
+            p += 4;
+            n -= 4;
+        }
+        for (; n > 0; ++p, --n) {
+            h ^= *p * P5;
+            h = rotl(h, 11) * P1;
+        }
+
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static const uint64_t P1 = 11400714785074694791ULL;
+    static const uint64_t P2 = 14029467366897019727ULL;
+    static const uint64_t P3 = 1609587929392839161ULL;
+    static const uint64_t P4 = 9650029242287828579ULL;
+    static const uint64_t P5 = 2870177450012600261ULL;
+
+    uint64_t m_seed;
+    uint64_t m_acc[4];
+    uint64_t m_total;
+    unsigned char m_buffer[32];
+    size_t m_buffered;
+
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    static uint64_t round(uint64_t acc, uint64_t input) {
+        acc += input * P2;
+        return rotl(acc, 31) * P1;
+    }
+
+    // Little-endian loads, so digests agree across platforms
+    static uint64_t read64(const unsigned char *p) {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+        return v;
+    }
+
+    static uint32_t read32(const unsigned char *p) {
+        return uint32_t(p[0]) | (uint32_t(p[1]) << 8) |
+            (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+    }
+
+    void stripe(const unsigned char *p) {
+        for (int i = 0; i < 4; ++i) {
+            m_acc[i] = round(m_acc[i], read64(p + 8 * i));
+        }
+    }
+};
+
+// 128-bit content hash: two XXH64 lanes with different seeds over the
+// same bytes, rendered as 32 hex digits. Values are fed in their native
+// representation, so a hash is only comparable with others made on
+// machines of the same byte order.
+class ContentHash {
+public:
+    ContentHash() : m_low(0), m_high(0x9E3779B97F4A7C15ULL) {}
+
+    void update(const void *data, size_t n) {
+        m_low.update(data, n);
+        m_high.update(data, n);
+    }
+
+    // Strings are length-prefixed, so consecutive fields cannot run
+    // into one another
+    void update(const std::string &s) {
+        add(uint64_t(s.size()));
+        update(s.data(), s.size());
+    }
+
+    template <typename T>
+    void add(const T &value) { update(&value, sizeof(value)); }
+
+    std::string hex() const {
+        static const char digits[] = "0123456789abcdef";
+        uint64_t lanes[2] = { m_high.digest(), m_low.digest() };
+        std::string s(32, '0');
+        for (int i = 0; i < 32; ++i) {
+            uint64_t lane = lanes[i / 16];
+            s[i] = digits[(lane >> (60 - 4 * (i % 16))) & 0xf];
+        }
+        return s;
+    }
+
+private:
+    XXH64 m_low;
+    XXH64 m_high;
+};
+
+#endif
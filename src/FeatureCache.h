@@ -0,0 +1,231 @@
+#ifndef FEATURE_CACHE_H
+#define FEATURE_CACHE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "FeatureData.h"
+#include "BinaryIO.h"
+
+// Compact binary files holding the features of one run, for the
+// runPlugin() result cache.
+//
+// A file is the magic "RVC1", a byte-order marker, the width of a value
+// offset and the output count, then per output its number, identifier,
+// bin count, value column count and feature count, followed by the
+// timestamp, duration, label and value columns as they are held in
+// FeatureData, so a cached result is read back with a handful of bulk
+// reads. Numbers are written in native
+// byte order; a file from a machine of the other order fails the marker
+// check and is treated as a miss.
+//
+// Files are written under a temporary name and renamed into place, so
+// a reader never sees a partial file, even with several R sessions
+// sharing one cache directory, and an existing file stays in place until
+// the new one replaces it.
+class FeatureCache {
+public:
+    // Read the file at path into data, returning false if it is missing,
+    // truncated or not a cache file
+    static bool load(const std::string &path, std::map<int, FeatureData> &data) {
+        std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+        if (!in) return false;
+        BinaryReader r(in);
+
+        char magic[4];
+        uint32_t order, offsetSize;
+        if (!r.bytes(magic, 4) || std::string(magic, 4) != "RVC1" ||
+            !r.get(order) || order != ByteOrder ||
+            !r.get(offsetSize) || offsetSize != sizeof(size_t)) {
+            return false;
+        }
+        return readFeatures(r, data);
+    }
+
+    // Write data to path, replacing any existing file. Returns false if
+    // the file could not be written.
+    static bool store(const std::string &path, const std::map<int, FeatureData> &data) {
+        std::string temp = temporaryPath(path);
+        {
+            std::ofstream out(temp.c_str(), std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+            BinaryWriter w(out);
+            w.bytes("RVC1", 4);
+            w.put(uint32_t(ByteOrder));
+            w.put(uint32_t(sizeof(size_t)));
+            writeFeatures(w, data);
+            if (!close(out, temp)) return false;
+        }
+        return replace(temp, path);
+    }
+
+    // The output count and the outputs, as in a cache file after its
+    // header; for other files that hold a run's features
+    static bool readFeatures(BinaryReader &r, std::map<int, FeatureData> &data) {
+        uint32_t outputs;
+        if (!r.get(outputs)) return false;
+
+        std::map<int, FeatureData> result;
+        for (uint32_t i = 0; i < outputs; ++i) {
+            int32_t outputNo, binCount, numValueCols;
+            uint64_t n;
+            FeatureData fd;
+            if (!r.get(outputNo) || !r.string(fd.outputIdentifier) ||
+                !r.get(binCount) || !r.get(numValueCols) || !r.get(n) ||
+                !r.column(fd.timestamp, n) || !r.column(fd.duration, n)) {
+                return false;
+            }
+            fd.binCount = binCount;
+            fd.numValueCols = numValueCols;
+            fd.label.resize(n);
+            for (uint64_t j = 0; j < n; ++j) {
+                if (!r.string(fd.label[j])) return false;
+            }
+            uint64_t values, offsets;
+            if (!r.get(values) || !r.column(fd.values, values) ||
+                !r.get(offsets) || !r.column(fd.valueOffset, offsets)) {
+                return false;
+            }
+            if (binCount >= 0 ? values != n * uint64_t(binCount)
+                              : (n > 0 && offsets != n + 1)) {
+                return false;
+            }
+            result[outputNo] = std::move(fd);
+        }
+        data.swap(result);
+        return true;
+    }
+
+    // Write the output count and the outputs of data, keeping only the
+    // features timestamped before limit (all of them by default). Kept
+    // features are written from data in place, a run of consecutive ones
+    // at a time, so nothing is copied to leave the others out.
+    static void writeFeatures(BinaryWriter &w, const std::map<int, FeatureData> &data,
+                              double limit = std::numeric_limits<double>::infinity()) {
+        w.put(uint32_t(data.size()));
+        for (std::map<int, FeatureData>::const_iterator it = data.begin();
+             it != data.end(); ++it) {
+            const FeatureData &fd = it->second;
+            size_t n = 0;
+            size_t values = 0;
+            for (size_t j = 0; j < fd.size(); ++j) {
+                if (fd.timestamp[j] < limit) {
+                    ++n;
+                    values += size_t(fd.valueCount(j));
+                }
+            }
+            w.put(int32_t(it->first));
+            w.string(fd.outputIdentifier);
+            w.put(int32_t(fd.binCount));
+            w.put(int32_t(fd.numValueCols));
+            w.put(uint64_t(n));
+            if (n == fd.size()) {
+                w.column(fd.timestamp);
+                w.column(fd.duration);
+                for (size_t j = 0; j < fd.size(); ++j) w.string(fd.label[j]);
+                w.put(uint64_t(fd.values.size()));
+                w.column(fd.values);
+                w.put(uint64_t(fd.valueOffset.size()));
+                w.column(fd.valueOffset);
+                continue;
+            }
+
+            std::vector<std::pair<size_t, size_t>> runs;
+            for (size_t j = 0; j < fd.size(); ) {
+                if (!(fd.timestamp[j] < limit)) { ++j; continue; }
+                size_t k = j + 1;
+                while (k < fd.size() && fd.timestamp[k] < limit) ++k;
+                runs.push_back(std::make_pair(j, k));
+                j = k;
+            }
+            for (const auto &run : runs) {
+                w.bytes(&fd.timestamp[run.first], (run.second - run.first) * sizeof(double));
+            }
+            for (const auto &run : runs) {
+                w.bytes(&fd.duration[run.first], (run.second - run.first) * sizeof(double));
+            }
+            for (const auto &run : runs) {
+                for (size_t j = run.first; j < run.second; ++j) w.string(fd.label[j]);
+            }
+            w.put(uint64_t(values));
+            for (const auto &run : runs) {
+                const float *begin = fd.featureValues(run.first);
+                const float *end = run.second < fd.size() ? fd.featureValues(run.second)
+                                                         : fd.values.data() + fd.values.size();
+                w.bytes(begin, size_t(end - begin) * sizeof(float));
+            }
+            if (fd.binCount >= 0 || n == 0) {
+                w.put(uint64_t(0));
+                continue;
+            }
+            // Offsets are renumbered to the kept values
+            w.put(uint64_t(n + 1));
+            size_t offset = 0;
+            w.put(offset);
+            for (const auto &run : runs) {
+                for (size_t j = run.first; j < run.second; ++j) {
+                    offset += size_t(fd.valueCount(j));
+                    w.put(offset);
+                }
+            }
+        }
+    }
+
+    // A name to write path under before replace()
+    static std::string temporaryPath(const std::string &path) {
+        return path + ".tmp" + uniqueSuffix();
+    }
+
+    // Flush and close a file written to temp, removing it and returning
+    // false if the writes failed
+    static bool close(std::ofstream &out, const std::string &temp) {
+        out.flush();
+        if (!out) {
+            out.close();
+            std::remove(temp.c_str());
+            return false;
+        }
+        out.close();
+        return true;
+    }
+
+    // Move the file written to temp into place at path
+    static bool replace(const std::string &temp, const std::string &path) {
+#ifdef _WIN32
+        // rename() will not replace an existing file on Windows
+        bool moved = MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        // rename() replaces an existing file atomically, so there is
+        // never a moment with no file at path
+        bool moved = std::rename(temp.c_str(), path.c_str()) == 0;
+#endif
+        if (!moved) {
+            std::remove(temp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    static const uint32_t ByteOrder = 0x01020304;
+
+private:
+    static std::string uniqueSuffix() {
+        std::random_device random;
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "%08x%08x", unsigned(random()), unsigned(random()));
+        return buf;
+    }
+};
+
+#endif
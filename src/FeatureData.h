@@ -0,0 +1,119 @@
+#ifndef FEATURE_DATA_H
+#define FEATURE_DATA_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+// Struct to collect features in memory for single output.
+//
+// Storage is columnar: one entry per feature in timestamp, duration and
+// label, and the values of all features end to end in one buffer. For
+// an output with a fixed bin count every feature has binCount values,
+// feature j's starting at j * binCount. Otherwise binCount is -1 and
+// feature j's values are [valueOffset[j], valueOffset[j + 1]). A fixed
+// layout falls back to offsets if a plugin breaks its own bin count.
+struct FeatureData {
+    std::vector<double> timestamp;
+    std::vector<double> duration;
+    std::vector<std::string> label;
+    std::vector<float> values;
+    std::vector<size_t> valueOffset;
+    int binCount;
+    int numValueCols;
+    std::string outputIdentifier;
+
+    FeatureData() : binCount(-1), numValueCols(0) {}
+
+    size_t size() const { return timestamp.size(); }
+
+    int valueCount(size_t j) const {
+        return binCount >= 0 ? binCount : static_cast<int>(valueOffset[j + 1] - valueOffset[j]);
+    }
+
+    const float *featureValues(size_t j) const {
+        return values.data() + (binCount >= 0 ? j * binCount : valueOffset[j]);
+    }
+
+    // Reserve room for the given number of features
+    void reserve(size_t features) {
+        timestamp.reserve(features);
+        duration.reserve(features);
+        label.reserve(features);
+        if (binCount >= 0) {
+            values.reserve(features * binCount);
+        } else {
+            valueOffset.reserve(features + 1);
+        }
+    }
+
+    // Store the values of the feature whose timestamp was pushed last
+    void addValues(const std::vector<float> &v) {
+        if (binCount >= 0 && static_cast<int>(v.size()) != binCount) {
+            useOffsets(size() - 1);
+        }
+        values.insert(values.end(), v.begin(), v.end());
+        if (binCount < 0) {
+            if (valueOffset.empty()) valueOffset.push_back(0);
+            valueOffset.push_back(values.size());
+        }
+        numValueCols = std::max(numValueCols, static_cast<int>(v.size()));
+    }
+
+    // Drop the stored features, keeping the layout and the capacity
+    void clear() {
+        timestamp.clear();
+        duration.clear();
+        label.clear();
+        values.clear();
+        valueOffset.clear();
+    }
+
+    // Approximate bytes held by the stored features
+    size_t bytes() const {
+        size_t n = size() * (2 * sizeof(double) + sizeof(std::string)) +
+            values.size() * sizeof(float) + valueOffset.size() * sizeof(size_t);
+        for (size_t j = 0; j < label.size(); ++j) n += label[j].size();
+        return n;
+    }
+
+    // Append the features another run collected for the same output
+    void append(const FeatureData &other) {
+        if (outputIdentifier.empty()) outputIdentifier = other.outputIdentifier;
+        if (size() == 0) {
+            binCount = other.binCount;
+            values.clear();
+            valueOffset.clear();
+        }
+        if (binCount >= 0 && other.binCount == binCount) {
+            values.insert(values.end(), other.values.begin(), other.values.end());
+        } else {
+            useOffsets(size());
+            if (valueOffset.empty()) valueOffset.push_back(0);
+            for (size_t j = 0; j < other.size(); ++j) {
+                const float *v = other.featureValues(j);
+                values.insert(values.end(), v, v + other.valueCount(j));
+                valueOffset.push_back(values.size());
+            }
+        }
+        timestamp.insert(timestamp.end(), other.timestamp.begin(), other.timestamp.end());
+        duration.insert(duration.end(), other.duration.begin(), other.duration.end());
+        label.insert(label.end(), other.label.begin(), other.label.end());
+        numValueCols = std::max(numValueCols, other.numValueCols);
+    }
+
+private:
+    // Switch from the fixed layout to offsets, given the number of
+    // features whose values are already stored
+    void useOffsets(size_t features) {
+        if (binCount < 0) return;
+        valueOffset.resize(features + 1);
+        for (size_t j = 0; j <= features; ++j) {
+            valueOffset[j] = j * binCount;
+        }
+        binCount = -1;
+    }
+};
+
+#endif
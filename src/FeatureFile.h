@@ -0,0 +1,306 @@
+#ifndef FEATURE_FILE_H
+#define FEATURE_FILE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+
+#include "FeatureData.h"
+#include "BinaryIO.h"
+
+// Feature files written incrementally by runPluginToFile().
+//
+// A file is a header, then any number of segments, each holding a run
+// of consecutive features of one output in columnar form, then a table
+// of the outputs. The header is the magic "RVF1", a byte-order marker,
+// the sample rate, whether timestamps are frames, and the position of
+// the output table, which stays 0 until the writer is closed; a reader
+// rejects a file without one as unfinished.
+//
+// A segment is its output number and byte length, then the bin count
+// (-1 for a variable layout), the feature count n, the n timestamps and
+// n durations, for a variable layout the n value counts, the value
+// count and the values, and the n labels. The output table holds each
+// output's number, identifier, value column count and total features,
+// including outputs that had no features and so have no segments.
+// Numbers are in native byte order.
+
+class FeatureFileWriter {
+public:
+    // Outputs are written out once they hold bufferBytes of features
+    explicit FeatureFileWriter(size_t bufferBytes = size_t(1) << 20) :
+        m_bufferBytes(bufferBytes), m_failed(false) {}
+
+    bool open(const std::string &path, int sampleRate, bool useFrames) {
+        m_path = path;
+        m_out.open(path.c_str(), std::ios::binary | std::ios::trunc);
+        if (!m_out) return fail();
+        BinaryWriter w(m_out);
+        w.bytes("RVF1", 4);
+        w.put(uint32_t(ByteOrder));
+        w.put(int32_t(sampleRate));
+        w.put(int32_t(useFrames ? 1 : 0));
+        w.put(uint64_t(0));
+        return bool(m_out) || fail();
+    }
+
+    // List an output in the output table even if it never produces a
+    // feature, so that it can be read back as empty
+    void declare(int outputNo, const std::string &identifier) {
+        m_outputs[outputNo].identifier = identifier;
+    }
+
+    // Write out and clear the outputs in data holding at least the
+    // buffer size of features, or all of them if all is true. After a
+    // write error features are discarded, so memory stays bounded;
+    // close() reports the error.
+    //
+    // This is called after every block, so the size of each output is
+    // kept up to date from the features added since the last call,
+    // rather than by walking all of them again.
+    void drain(std::map<int, FeatureData> &data, bool all = false) {
+        for (std::map<int, FeatureData>::iterator it = data.begin(); it != data.end(); ++it) {
+            FeatureData &fd = it->second;
+            if (fd.size() == 0) continue;
+            Pending &pending = m_pending[it->first];
+            if (!all && pending.update(fd) < m_bufferBytes) continue;
+            if (!m_failed) writeSegment(it->first, fd);
+            fd.clear();
+            pending = Pending();
+        }
+    }
+
+    // Write out everything left in data, then the output table. Returns
+    // false if any write failed.
+    bool close(std::map<int, FeatureData> &data) {
+        drain(data, true);
+        if (m_failed) {
+            m_out.close();
+            return false;
+        }
+        BinaryWriter w(m_out);
+        uint64_t table = uint64_t(m_out.tellp());
+        w.put(int32_t(-1));
+        w.put(uint32_t(m_outputs.size()));
+        for (std::map<int, Output>::const_iterator it = m_outputs.begin();
+             it != m_outputs.end(); ++it) {
+            w.put(int32_t(it->first));
+            w.string(it->second.identifier);
+            w.put(int32_t(it->second.numValueCols));
+            w.put(uint64_t(it->second.features));
+        }
+        m_out.seekp(TableOffsetPosition);
+        w.put(table);
+        m_out.close();
+        if (!m_out) return fail();
+        return true;
+    }
+
+    const std::string &path() const { return m_path; }
+
+    struct Output {
+        std::string identifier;
+        int numValueCols;
+        uint64_t features;
+        Output() : numValueCols(0), features(0) {}
+    };
+
+    // Outputs written so far, by output number
+    const std::map<int, Output> &outputs() const { return m_outputs; }
+
+    static const uint32_t ByteOrder = 0x01020304;
+    static const std::streamoff TableOffsetPosition = 16;
+
+private:
+    size_t m_bufferBytes;
+    bool m_failed;
+    std::string m_path;
+    std::ofstream m_out;
+    std::map<int, Output> m_outputs;
+    std::vector<uint32_t> m_counts;
+
+    // Label bytes of the features of an output buffered so far, and how
+    // many of those features have been counted
+    struct Pending {
+        size_t counted;
+        size_t labelBytes;
+        Pending() : counted(0), labelBytes(0) {}
+
+        // Bytes held by fd, as FeatureData::bytes()
+        size_t update(const FeatureData &fd) {
+            for (; counted < fd.size(); ++counted) labelBytes += fd.label[counted].size();
+            return fd.size() * (2 * sizeof(double) + sizeof(std::string)) +
+                fd.values.size() * sizeof(float) + fd.valueOffset.size() * sizeof(size_t) +
+                labelBytes;
+        }
+    };
+    std::map<int, Pending> m_pending;
+
+    bool fail() {
+        m_failed = true;
+        return false;
+    }
+
+    void writeSegment(int outputNo, const FeatureData &fd) {
+        size_t n = fd.size();
+        uint64_t length = 4 + 8 + 2 * n * sizeof(double) + 8 + fd.values.size() * sizeof(float);
+        if (fd.binCount < 0) {
+            m_counts.resize(n);
+            for (size_t j = 0; j < n; ++j) m_counts[j] = uint32_t(fd.valueCount(j));
+            length += n * sizeof(uint32_t);
+        }
+        for (size_t j = 0; j < n; ++j) length += 4 + fd.label[j].size();
+
+        BinaryWriter w(m_out);
+        w.put(int32_t(outputNo));
+        w.put(length);
+        w.put(int32_t(fd.binCount));
+        w.put(uint64_t(n));
+        w.column(fd.timestamp);
+        w.column(fd.duration);
+        if (fd.binCount < 0) w.column(m_counts);
+        w.put(uint64_t(fd.values.size()));
+        w.column(fd.values);
+        for (size_t j = 0; j < n; ++j) w.string(fd.label[j]);
+        if (!m_out) {
+            fail();
+            return;
+        }
+
+        Output &output = m_outputs[outputNo];
+        output.identifier = fd.outputIdentifier;
+        output.numValueCols = std::max(output.numValueCols, fd.numValueCols);
+        output.features += n;
+    }
+};
+
+class FeatureFileReader {
+public:
+    // Read the features of the outputs named in outputIds, or all
+    // outputs if it is empty, from the file at path. On failure returns
+    // false with the reason in error.
+    static bool read(const std::string &path, const std::vector<std::string> &outputIds,
+                     std::map<int, FeatureData> &data, int &sampleRate, bool &useFrames,
+                     std::string &error) {
+        std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+        if (!in) return failed(error, "cannot open file");
+        BinaryReader r(in);
+
+        char magic[4];
+        uint32_t order;
+        int32_t rate, frames;
+        uint64_t table;
+        if (!r.bytes(magic, 4) || std::string(magic, 4) != "RVF1") {
+            return failed(error, "not a ReVAMP feature file");
+        }
+        if (!r.get(order) || order != FeatureFileWriter::ByteOrder) {
+            return failed(error, "written on a machine of different byte order");
+        }
+        if (!r.get(rate) || !r.get(frames) || !r.get(table)) {
+            return failed(error, "truncated header");
+        }
+        if (table == 0) return failed(error, "file was not finished");
+        uint64_t segments = r.position();
+
+        // The output table comes first, to know which segments to keep
+        std::map<int, FeatureData> result;
+        int32_t marker;
+        uint32_t count;
+        if (!r.seek(table) || !r.get(marker) || marker != -1 || !r.get(count)) {
+            return failed(error, "damaged output table");
+        }
+        std::vector<std::string> found;
+        for (uint32_t i = 0; i < count; ++i) {
+            int32_t outputNo, numValueCols;
+            uint64_t features;
+            std::string identifier;
+            if (!r.get(outputNo) || !r.string(identifier) ||
+                !r.get(numValueCols) || !r.get(features)) {
+                return failed(error, "damaged output table");
+            }
+            found.push_back(identifier);
+            if (!outputIds.empty() &&
+                std::find(outputIds.begin(), outputIds.end(), identifier) == outputIds.end()) {
+                continue;
+            }
+            FeatureData &fd = result[outputNo];
+            fd.outputIdentifier = identifier;
+            fd.numValueCols = numValueCols;
+        }
+        for (size_t i = 0; i < outputIds.size(); ++i) {
+            if (std::find(found.begin(), found.end(), outputIds[i]) == found.end()) {
+                std::string available;
+                for (size_t k = 0; k < found.size(); ++k) {
+                    available += (k > 0 ? ", " : "") + found[k];
+                }
+                return failed(error, "no output '" + outputIds[i] +
+                              "' (outputs in file: " + available + ")");
+            }
+        }
+
+        if (!r.seek(segments)) return failed(error, "truncated file");
+        FeatureData segment;
+        std::vector<uint32_t> counts;
+        while (r.position() < table) {
+            int32_t outputNo;
+            uint64_t length;
+            if (!r.get(outputNo) || !r.get(length) || length > table - r.position()) {
+                return failed(error, "damaged segment");
+            }
+            uint64_t next = r.position() + length;
+            std::map<int, FeatureData>::iterator it = result.find(outputNo);
+            if (it != result.end()) {
+                if (!readSegment(r, segment, counts)) return failed(error, "damaged segment");
+                segment.outputIdentifier = it->second.outputIdentifier;
+                it->second.append(segment);
+            }
+            if (!r.seek(next)) return failed(error, "truncated file");
+        }
+
+        data.swap(result);
+        sampleRate = rate;
+        useFrames = frames != 0;
+        return true;
+    }
+
+private:
+    static bool failed(std::string &error, const std::string &why) {
+        error = why;
+        return false;
+    }
+
+    static bool readSegment(BinaryReader &r, FeatureData &fd, std::vector<uint32_t> &counts) {
+        int32_t binCount;
+        uint64_t n, values;
+        if (!r.get(binCount) || !r.get(n) ||
+            !r.column(fd.timestamp, n) || !r.column(fd.duration, n)) {
+            return false;
+        }
+        fd.binCount = binCount;
+        fd.numValueCols = 0;
+        fd.valueOffset.clear();
+        if (binCount < 0) {
+            if (!r.column(counts, n)) return false;
+            fd.valueOffset.resize(n + 1);
+            fd.valueOffset[0] = 0;
+            for (uint64_t j = 0; j < n; ++j) {
+                fd.valueOffset[j + 1] = fd.valueOffset[j] + counts[j];
+            }
+        }
+        if (!r.get(values) || !r.column(fd.values, values)) return false;
+        if (values != (binCount >= 0 ? n * uint64_t(binCount) : uint64_t(fd.valueOffset[n]))) {
+            return false;
+        }
+        fd.label.resize(n);
+        for (uint64_t j = 0; j < n; ++j) {
+            if (!r.string(fd.label[j])) return false;
+        }
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,540 @@
+#ifndef FLAC_READER_H
+#define FLAC_READER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+
+#include "MappedFile.h"
+
+// Reads FLAC files, decoding one FLAC frame at a time as samples are
+// requested, so memory stays bounded by the block size however long the
+// file is.
+//
+// The decoder handles every subframe type (constant, verbatim, fixed
+// and LPC prediction), both residual coding methods, wasted bits and the
+// stereo decorrelation modes, for 4 to 32 bits per sample. Checksums are
+// not verified; a damaged frame ends the audio early, as a truncated
+// data chunk does for WAV files.
+//
+// seek() starts decoding at the nearest point at or before the target
+// listed in the file's SEEKTABLE, or where it is already decoding if
+// that is nearer, so regions deep into a long file cost little more than
+// the frames they contain.
+//
+// As for WAV, the file is memory-mapped where possible and read through
+// a stream otherwise.
+class FlacReader {
+public:
+    FlacReader() : m_channels(0), m_sampleRate(0), m_bitsPerSample(0), m_maxBlockSize(0),
+                   m_frames(0), m_firstFrame(0), m_scale(0), m_position(0), m_blockStart(0),
+                   m_blockLength(0), m_data(nullptr), m_size(0), m_base(0), m_byte(0),
+                   m_cache(0), m_cacheBits(0), m_bad(false) {}
+
+    // Parse the metadata blocks and position the reader at the first
+    // frame. On failure returns false and error() describes why. With
+    // mapData false the file is read through a small stream buffer
+    // instead of being mapped, so opening it touches only the metadata,
+    // as when probing many files.
+    bool open(const std::string &filename, bool mapData = true) {
+        m_file.close();
+        m_file.clear();
+        m_map.close();
+        m_error.clear();
+        m_seekTable.clear();
+        m_channels = 0;
+        m_sampleRate = 0;
+        m_bitsPerSample = 0;
+        m_frames = 0;
+        m_position = 0;
+        m_blockStart = 0;
+        m_blockLength = 0;
+
+        if (mapData && m_map.open(filename)) {
+            m_data = m_map.data();
+            m_size = size_t(m_map.size());
+        } else {
+            m_file.open(filename, std::ios::binary);
+            if (!m_file.is_open()) {
+                return fail("Failed to open file: " + filename);
+            }
+            m_buffer.resize(mapData ? BufferSize : ProbeBufferSize);
+            m_data = m_buffer.data();
+            m_size = 0;
+        }
+        m_base = 0;
+        resetBits(0);
+
+        // An ID3v2 tag may precede the stream
+        if (readBits(24) == 0x494433) {
+            readBits(24);
+            uint32_t length = 0;
+            for (int i = 0; i < 4; ++i) length = (length << 7) | (readBits(8) & 0x7f);
+            seekByte(10 + uint64_t(length));
+        } else {
+            seekByte(0);
+        }
+        if (readBits(32) != 0x664c6143) { // "fLaC"
+            return fail("Not a FLAC file");
+        }
+
+        bool last = false;
+        bool streamInfo = false;
+        while (!last) {
+            last = readBits(1) != 0;
+            uint32_t type = readBits(7);
+            uint32_t length = readBits(24);
+            if (m_bad) return fail("Truncated FLAC metadata");
+            uint64_t next = tell() + length;
+
+            if (type == 0 && length >= 34) { // STREAMINFO
+                readBits(16); // minimum block size
+                m_maxBlockSize = int(readBits(16));
+                readBits(24); // minimum frame size
+                readBits(24); // maximum frame size
+                m_sampleRate = int(readBits(20));
+                m_channels = int(readBits(3)) + 1;
+                m_bitsPerSample = int(readBits(5)) + 1;
+                m_frames = (int64_t(readBits(4)) << 32) | int64_t(readBits(32));
+                streamInfo = true;
+            } else if (type == 3) { // SEEKTABLE
+                for (uint32_t i = 0; i + 18 <= length; i += 18) {
+                    SeekPoint point;
+                    point.frame = (uint64_t(readBits(32)) << 32) | readBits(32);
+                    point.offset = (uint64_t(readBits(32)) << 32) | readBits(32);
+                    readBits(16); // frames in the target block
+                    // Placeholder points have an all-ones frame number
+                    if (point.frame != ~uint64_t(0)) m_seekTable.push_back(point);
+                }
+            }
+            if (m_bad || !seekByte(next)) return fail("Truncated FLAC metadata");
+        }
+
+        if (!streamInfo) {
+            return fail("FLAC file has no STREAMINFO block");
+        }
+        if (m_sampleRate == 0 || m_bitsPerSample < 4) {
+            return fail("Unsupported FLAC stream: " + std::to_string(m_sampleRate) + " Hz, " +
+                        std::to_string(m_bitsPerSample) + " bits");
+        }
+        if (m_frames == 0) {
+            return fail("FLAC file does not record its length");
+        }
+        m_firstFrame = tell();
+        m_scale = 1.0 / double(int64_t(1) << (m_bitsPerSample - 1));
+        m_block.assign(m_channels, std::vector<int64_t>());
+        return true;
+    }
+
+    int channels() const { return m_channels; }
+    int sampleRate() const { return m_sampleRate; }
+    int bitsPerSample() const { return m_bitsPerSample; }
+
+    // Number of sample frames in the stream, from STREAMINFO
+    int64_t frames() const { return m_frames; }
+
+    // Frame index of the next frame returned by readPlanar()
+    int64_t position() const { return m_position; }
+
+    // Number of usable points in the file's SEEKTABLE
+    size_t seekPoints() const { return m_seekTable.size(); }
+
+    const std::string &error() const { return m_error; }
+
+    // Position the reader so that the next read starts at the given frame
+    bool seek(int64_t frame) {
+        if (frame < 0 || frame > m_frames) return false;
+        if (frame >= m_blockStart && frame < m_blockStart + m_blockLength) {
+            m_position = frame;
+            return true;
+        }
+
+        // Decode forwards from the current block if it is before the
+        // target and no seek point is nearer, otherwise from the last
+        // seek point at or before the target
+        uint64_t offset = m_firstFrame;
+        int64_t from = 0;
+        for (size_t i = 0; i < m_seekTable.size(); ++i) {
+            if (int64_t(m_seekTable[i].frame) <= frame && int64_t(m_seekTable[i].frame) >= from) {
+                from = int64_t(m_seekTable[i].frame);
+                offset = m_firstFrame + m_seekTable[i].offset;
+            }
+        }
+        if (!(m_blockLength > 0 && m_blockStart + m_blockLength <= frame &&
+              m_blockStart + m_blockLength > from)) {
+            if (!seekByte(offset)) return false;
+            m_blockLength = 0;
+        }
+
+        m_position = frame;
+        if (frame == m_frames) return true;
+        while (!(frame >= m_blockStart && frame < m_blockStart + m_blockLength)) {
+            if (!decodeFrame() || m_blockStart > frame) {
+                m_blockLength = 0;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Decode up to n frames, one buffer per channel. Returns the number
+    // of frames decoded, which is less than n only at the end of the
+    // stream or if the file is truncated or damaged.
+    int64_t readPlanar(float *const *dest, int64_t n) {
+        n = std::max<int64_t>(0, std::min(n, m_frames - m_position));
+        int64_t done = 0;
+        while (done < n) {
+            if (m_position < m_blockStart || m_position >= m_blockStart + m_blockLength) {
+                if (!decodeFrame() || m_position < m_blockStart ||
+                    m_position >= m_blockStart + m_blockLength) {
+                    m_blockLength = 0;
+                    break;
+                }
+            }
+            const int64_t offset = m_position - m_blockStart;
+            const int64_t count = std::min(n - done, m_blockLength - offset);
+            for (int c = 0; c < m_channels; ++c) {
+                const int64_t *in = m_block[c].data() + offset;
+                float *out = dest[c] + done;
+                for (int64_t i = 0; i < count; ++i) {
+                    out[i] = float(double(in[i]) * m_scale);
+                }
+            }
+            done += count;
+            m_position += count;
+        }
+        return done;
+    }
+
+private:
+    struct SeekPoint {
+        uint64_t frame;
+        uint64_t offset; // in bytes from the first frame header
+    };
+
+    static const size_t BufferSize = size_t(1) << 18;
+    static const size_t ProbeBufferSize = 4096;
+
+    int m_channels;
+    int m_sampleRate;
+    int m_bitsPerSample;
+    int m_maxBlockSize;
+    int64_t m_frames;
+    uint64_t m_firstFrame; // byte offset of the first frame header
+    double m_scale;
+    std::vector<SeekPoint> m_seekTable;
+
+    // The most recently decoded block, one buffer per channel
+    int64_t m_position;
+    int64_t m_blockStart;
+    int64_t m_blockLength;
+    std::vector<std::vector<int64_t> > m_block;
+    std::vector<int64_t> m_coefs;
+
+    // Input bytes: the whole mapping, or a window of the stream held in
+    // m_buffer, starting at byte m_base of the file
+    MappedFile m_map;
+    std::ifstream m_file;
+    std::vector<unsigned char> m_buffer;
+    const unsigned char *m_data;
+    size_t m_size;
+    uint64_t m_base;
+
+    // Bit reader: m_cache holds the next m_cacheBits bits, most
+    // significant first, and m_byte is the next byte to load into it
+    size_t m_byte;
+    uint64_t m_cache;
+    int m_cacheBits;
+    bool m_bad; // set when a read runs past the end of the file
+
+    std::string m_error;
+
+    bool fail(const std::string &message) {
+        m_error = message;
+        m_file.close();
+        m_map.close();
+        return false;
+    }
+
+    // Move the unread part of the stream window to the front of the
+    // buffer and read more after it. Always false for a mapped file.
+    bool refill() {
+        if (!m_file.is_open() || !m_file) return false;
+        std::memmove(m_buffer.data(), m_buffer.data() + m_byte, m_size - m_byte);
+        m_base += m_byte;
+        m_size -= m_byte;
+        m_byte = 0;
+        m_file.read(reinterpret_cast<char *>(m_buffer.data() + m_size),
+                    std::streamsize(m_buffer.size() - m_size));
+        m_size += size_t(m_file.gcount());
+        return m_file.gcount() > 0;
+    }
+
+    void fill() {
+        while (m_cacheBits <= 56) {
+            if (m_byte >= m_size && !refill()) return;
+            m_cache |= uint64_t(m_data[m_byte++]) << (56 - m_cacheBits);
+            m_cacheBits += 8;
+        }
+    }
+
+    void resetBits(size_t byte) {
+        m_byte = byte;
+        m_cache = 0;
+        m_cacheBits = 0;
+        m_bad = false;
+    }
+
+    // Byte offset in the file of the next unread byte; only meaningful
+    // on a byte boundary
+    uint64_t tell() const {
+        return m_base + m_byte - uint64_t(m_cacheBits / 8);
+    }
+
+    bool seekByte(uint64_t offset) {
+        if (offset >= m_base && offset <= m_base + m_size) {
+            resetBits(size_t(offset - m_base));
+            return true;
+        }
+        if (!m_file.is_open()) return false;
+        m_file.clear();
+        m_file.seekg(std::streamoff(offset), std::ios::beg);
+        if (!m_file) return false;
+        m_base = offset;
+        m_size = 0;
+        resetBits(0);
+        return true;
+    }
+
+    // Read n bits, for n up to 32
+    uint32_t readBits(int n) {
+        if (n == 0) return 0;
+        if (m_cacheBits < n) {
+            fill();
+            if (m_cacheBits < n) {
+                m_bad = true;
+                m_cacheBits = 0;
+                m_cache = 0;
+                return 0;
+            }
+        }
+        uint32_t value = uint32_t(m_cache >> (64 - n));
+        m_cache <<= n;
+        m_cacheBits -= n;
+        return value;
+    }
+
+    // Read an n-bit two's complement number, for n up to 33
+    int64_t readSigned(int n) {
+        if (n == 0) return 0;
+        uint64_t value = n > 32 ? (uint64_t(readBits(n - 32)) << 32) | readBits(32) : readBits(n);
+        return int64_t(value << (64 - n)) >> (64 - n);
+    }
+
+    // Count zero bits up to and including the next one bit
+    uint64_t readUnary() {
+        uint64_t zeros = 0;
+        while (true) {
+            if (m_cache == 0) {
+                zeros += m_cacheBits;
+                m_cacheBits = 0;
+                fill();
+                if (m_cacheBits == 0) {
+                    m_bad = true;
+                    return 0;
+                }
+                continue;
+            }
+            int run = __builtin_clzll(m_cache);
+            zeros += run;
+            m_cache = (m_cache << run) << 1;
+            m_cacheBits -= run + 1;
+            return zeros;
+        }
+    }
+
+    void alignToByte() {
+        readBits(m_cacheBits % 8);
+    }
+
+    bool corrupt() {
+        m_error = m_bad ? "Truncated FLAC file" : "Damaged FLAC frame";
+        return false;
+    }
+
+    // Decode the frame at the current position into m_block
+    bool decodeFrame() {
+        m_blockLength = 0;
+        if (readBits(15) != 0x7ffc) return corrupt();
+        const bool variableBlocks = readBits(1) != 0;
+        const uint32_t blockCode = readBits(4);
+        const uint32_t rateCode = readBits(4);
+        const uint32_t assignment = readBits(4);
+        const uint32_t sizeCode = readBits(3);
+        readBits(1);
+
+        // Frame or sample number, UTF-8 style
+        uint64_t number = readBits(8);
+        int more = 0;
+        if (number >= 0x80) {
+            while (number & (0x80 >> more)) ++more;
+            if (more < 2 || more > 7) return corrupt();
+            number &= 0x7f >> more;
+            --more;
+            for (int i = 0; i < more; ++i) {
+                uint32_t byte = readBits(8);
+                if ((byte & 0xc0) != 0x80) return corrupt();
+                number = (number << 6) | (byte & 0x3f);
+            }
+        }
+
+        int blockSize;
+        if (blockCode == 0) return corrupt();
+        else if (blockCode == 1) blockSize = 192;
+        else if (blockCode <= 5) blockSize = 576 << (blockCode - 2);
+        else if (blockCode == 6) blockSize = int(readBits(8)) + 1;
+        else if (blockCode == 7) blockSize = int(readBits(16)) + 1;
+        else blockSize = 256 << (blockCode - 8);
+
+        if (rateCode == 12) readBits(8);
+        else if (rateCode == 13 || rateCode == 14) readBits(16);
+        readBits(8); // header CRC
+
+        static const int sizes[8] = { 0, 8, 12, 0, 16, 20, 24, 32 };
+        const int bits = sizeCode == 0 ? m_bitsPerSample : sizes[sizeCode];
+        const int channels = assignment < 8 ? int(assignment) + 1 : 2;
+        if (assignment > 10 || channels != m_channels || bits != m_bitsPerSample) {
+            return corrupt();
+        }
+
+        for (int c = 0; c < channels; ++c) {
+            // The side channel needs one bit more than the others
+            bool side = (assignment == 8 && c == 1) || (assignment == 9 && c == 0) ||
+                (assignment == 10 && c == 1);
+            m_block[c].resize(blockSize);
+            if (!decodeSubframe(m_block[c].data(), blockSize, bits + (side ? 1 : 0))) {
+                return corrupt();
+            }
+        }
+        alignToByte();
+        readBits(16); // frame CRC
+        if (m_bad) return corrupt();
+
+        if (assignment >= 8) {
+            int64_t *a = m_block[0].data();
+            int64_t *b = m_block[1].data();
+            for (int i = 0; i < blockSize; ++i) {
+                if (assignment == 8) { // left, side
+                    b[i] = a[i] - b[i];
+                } else if (assignment == 9) { // side, right
+                    a[i] += b[i];
+                } else { // mid, side
+                    int64_t mid = (a[i] * 2) | (b[i] & 1);
+                    a[i] = (mid + b[i]) >> 1;
+                    b[i] = (mid - b[i]) >> 1;
+                }
+            }
+        }
+
+        m_blockStart = int64_t(variableBlocks ? number : number * uint64_t(m_maxBlockSize));
+        m_blockLength = std::min<int64_t>(blockSize, std::max<int64_t>(0, m_frames - m_blockStart));
+        return true;
+    }
+
+    bool decodeSubframe(int64_t *out, int n, int bits) {
+        if (readBits(1) != 0) return false;
+        const uint32_t type = readBits(6);
+        int wasted = 0;
+        if (readBits(1)) {
+            wasted = int(readUnary()) + 1;
+            if (wasted >= bits) return false;
+            bits -= wasted;
+        }
+
+        if (type == 0) { // constant
+            std::fill(out, out + n, readSigned(bits));
+        } else if (type == 1) { // verbatim
+            for (int i = 0; i < n; ++i) out[i] = readSigned(bits);
+        } else if (type >= 8 && type <= 12) { // fixed prediction
+            const int order = int(type) - 8;
+            if (order > n) return false;
+            for (int i = 0; i < order; ++i) out[i] = readSigned(bits);
+            if (!decodeResidual(out, n, order)) return false;
+            predictFixed(out, n, order);
+        } else if (type >= 32) { // linear prediction
+            const int order = int(type) - 31;
+            if (order > n) return false;
+            for (int i = 0; i < order; ++i) out[i] = readSigned(bits);
+            const int precision = int(readBits(4)) + 1;
+            const int shift = int(readSigned(5));
+            if (precision == 16 || shift < 0) return false;
+            m_coefs.resize(order);
+            for (int j = 0; j < order; ++j) m_coefs[j] = readSigned(precision);
+            if (!decodeResidual(out, n, order)) return false;
+            for (int i = order; i < n; ++i) {
+                int64_t sum = 0;
+                for (int j = 0; j < order; ++j) sum += m_coefs[j] * out[i - 1 - j];
+                out[i] += sum >> shift;
+            }
+        } else {
+            return false;
+        }
+
+        if (wasted > 0) {
+            for (int i = 0; i < n; ++i) out[i] *= int64_t(1) << wasted;
+        }
+        return !m_bad;
+    }
+
+    // Read the Rice-coded residual of samples [order, n) into out
+    bool decodeResidual(int64_t *out, int n, int order) {
+        const uint32_t method = readBits(2);
+        if (method > 1) return false;
+        const int parameterBits = method == 0 ? 4 : 5;
+        const uint32_t escape = method == 0 ? 15 : 31;
+        const int partitionOrder = int(readBits(4));
+        const int partitionSize = n >> partitionOrder;
+        if ((partitionSize << partitionOrder) != n || partitionSize < order) return false;
+
+        int i = order;
+        for (int p = 0; p < (1 << partitionOrder); ++p) {
+            const int end = (p + 1) * partitionSize;
+            const uint32_t parameter = readBits(parameterBits);
+            if (parameter == escape) {
+                const int bits = int(readBits(5));
+                for (; i < end; ++i) out[i] = readSigned(bits);
+            } else {
+                for (; i < end; ++i) {
+                    uint64_t value = (readUnary() << parameter) | readBits(int(parameter));
+                    out[i] = int64_t(value >> 1) ^ -int64_t(value & 1);
+                }
+            }
+            if (m_bad) return false;
+        }
+        return true;
+    }
+
+    static void predictFixed(int64_t *s, int n, int order) {
+        switch (order) {
+        case 1:
+            for (int i = 1; i < n; ++i) s[i] += s[i - 1];
+            break;
+        case 2:
+            for (int i = 2; i < n; ++i) s[i] += 2 * s[i - 1] - s[i - 2];
+            break;
+        case 3:
+            for (int i = 3; i < n; ++i) s[i] += 3 * s[i - 1] - 3 * s[i - 2] + s[i - 3];
+            break;
+        case 4:
+            for (int i = 4; i < n; ++i) {
+                s[i] += 4 * s[i - 1] - 6 * s[i - 2] + 4 * s[i - 3] - s[i - 4];
+            }
+            break;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// A whole file mapped read-only into memory.
+//
+// Reading through the mapping uses the pages of the operating system's
+// file cache directly, so there is no second copy of the data in a
+// read buffer and nothing is read from disk until it is touched. open()
+// fails for empty files and wherever the file cannot be mapped, e.g. a
+// file too large for a 32-bit address space; callers fall back to
+// ordinary reads then.
+class MappedFile {
+public:
+    MappedFile() : m_data(nullptr), m_size(0)
+#ifdef _WIN32
+        , m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+#endif
+    { }
+
+    ~MappedFile() { close(); }
+
+    bool open(const std::string &filename) {
+        close();
+#ifdef _WIN32
+        m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                             OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (m_file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size) || size.QuadPart <= 0 ||
+            uint64_t(size.QuadPart) > uint64_t(SIZE_MAX)) {
+            close();
+            return false;
+        }
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping) {
+            close();
+            return false;
+        }
+        void *data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!data) {
+            close();
+            return false;
+        }
+        m_data = static_cast<const unsigned char *>(data);
+        m_size = uint64_t(size.QuadPart);
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0 ||
+            uint64_t(st.st_size) > uint64_t(SIZE_MAX)) {
+            ::close(fd);
+            return false;
+        }
+        void *data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping holds its own reference to the file
+        ::close(fd);
+        if (data == MAP_FAILED) return false;
+#ifdef MADV_SEQUENTIAL
+        madvise(data, size_t(st.st_size), MADV_SEQUENTIAL);
+#endif
+        m_data = static_cast<const unsigned char *>(data);
+        m_size = uint64_t(st.st_size);
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (m_data) UnmapViewOfFile(m_data);
+        if (m_mapping) CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+#else
+        if (m_data) munmap(const_cast<unsigned char *>(m_data), size_t(m_size));
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    bool isOpen() const { return m_data != nullptr; }
+    const unsigned char *data() const { return m_data; }
+    uint64_t size() const { return m_size; }
+
+private:
+    const unsigned char *m_data;
+    uint64_t m_size;
+#ifdef _WIN32
+    HANDLE m_file;
+    HANDLE m_mapping;
+#endif
+
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+};
+
+#endif
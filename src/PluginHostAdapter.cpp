@@ -402,6 +402,12 @@ PluginHostAdapter::getRemainingFeatures()
     return fs;
 }
 
+void
+PluginHostAdapter::setOutputFilter(const std::vector<bool> &wanted)
+{
+    m_outputFilter = wanted;
+}
+
 void
 PluginHostAdapter::convertFeatures(VampFeatureList *features,
                                    FeatureSet &fs)
@@ -411,6 +417,11 @@ PluginHostAdapter::convertFeatures(VampFeatureList *features,
     unsigned int outputs = m_descriptor->getOutputCount(m_handle);
 
     for (unsigned int i = 0; i < outputs; ++i) {
+
+        if (!m_outputFilter.empty() &&
+            (i >= m_outputFilter.size() || !m_outputFilter[i])) {
+            continue;
+        }
         
         VampFeatureList &list = features[i];
 
@@ -7,13 +7,32 @@
 #include <cstdint>
 #include <memory>
 #include <vector>
+#include <limits>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <sstream>
+#include <chrono>
 
 #include <vamp-hostsdk/RealTime.h>
 #include <vamp-hostsdk/PluginHostAdapter.h>
 #include <vamp-hostsdk/PluginInputDomainAdapter.h>
 #include <vamp-hostsdk/PluginLoader.h>
 #include "system.h"
-#include "SimpleWavReader.h"
+#include "AudioSource.h"
+#include "AudioCache.h"
+#include "Resampler.h"
+#include "SharedDecode.h"
+#include "SilenceGate.h"
+#include "FeatureData.h"
+#include "FeatureCache.h"
+#include "Checkpoint.h"
+#include "FeatureFile.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include "BlockFramer.h"
+#include "ThreadPool.h"
 
 using namespace Rcpp;
 
@@ -29,35 +48,63 @@ double toSeconds(const RealTime &time)
   return time.sec + double(time.nsec + 1) / 1000000000.0;
 }
 
+// RealTime::frame2RealTime() and realTime2Frame() with 64-bit frame
+// numbers. The SDK versions use long, which is 32 bits on Windows and
+// would wrap after 2^31 frames (12 hours at 48 kHz).
+RealTime frameToRealTime(int64_t frame, int sampleRate)
+{
+  if (frame < 0) return -frameToRealTime(-frame, sampleRate);
+  RealTime rt;
+  rt.sec = static_cast<int>(frame / sampleRate);
+  frame -= int64_t(rt.sec) * sampleRate;
+  rt.nsec = static_cast<int>(((double(frame) * 1000000.0) / sampleRate) * 1000.0);
+  return rt;
+}
 
-// Struct to collect features in memory for single output
-struct FeatureData {
-  std::vector<double> timestamp;
-  std::vector<double> duration;
-  std::vector<std::string> label;
-  std::vector<std::vector<float>> values;
-  int numValueCols;
-  std::string outputIdentifier;
-  
-  FeatureData() : numValueCols(0) {}
-};
+int64_t realTimeToFrame(const RealTime &time, int sampleRate)
+{
+  if (time < RealTime::zeroTime) return -realTimeToFrame(-time, sampleRate);
+  double s = time.sec + double(time.nsec + 1) / 1000000000.0;
+  return static_cast<int64_t>(s * sampleRate);
+}
 
-// Collect features in memory for ALL outputs
-void collectAllFeatures(int frame, int sr,
+// Collect features in memory for ALL outputs, or those set in wanted if
+// it is not empty, keeping only features whose timestamp falls in the
+// frame range [keepFrom, keepUntil). An output's storage is reserved
+// for expected[output] features when its first feature arrives. With
+// useFrames, timestamps are stored as frames at frameRate if it is set,
+// for input that has been resampled from that rate to sr.
+void collectAllFeatures(int64_t frame, int sr,
                         const Plugin::OutputList &outputs,
                         const Plugin::FeatureSet &features,
                         std::map<int, FeatureData> &allData,
                         bool useFrames,
-                        std::map<int, RealTime> &lastFeatureTime)
+                        std::map<int, RealTime> &lastFeatureTime,
+                        const std::vector<bool> &wanted = std::vector<bool>(),
+                        const std::vector<size_t> &expected = std::vector<size_t>(),
+                        int64_t keepFrom = std::numeric_limits<int64_t>::min(),
+                        int64_t keepUntil = std::numeric_limits<int64_t>::max(),
+                        int frameRate = 0)
 {
   for (Plugin::FeatureSet::const_iterator fi = features.begin(); fi != features.end(); ++fi) {
     int outputNo = fi->first;
     
+    if (!wanted.empty() &&
+        (outputNo >= static_cast<int>(wanted.size()) || !wanted[outputNo])) {
+      continue;
+    }
+    
     // Make sure we have a FeatureData for this output
     if (allData.find(outputNo) == allData.end()) {
-      allData[outputNo] = FeatureData();
+      FeatureData &created = allData[outputNo];
       if (outputNo < static_cast<int>(outputs.size())) {
-        allData[outputNo].outputIdentifier = outputs[outputNo].identifier;
+        created.outputIdentifier = outputs[outputNo].identifier;
+        if (outputs[outputNo].hasFixedBinCount) {
+          created.binCount = static_cast<int>(outputs[outputNo].binCount);
+        }
+        if (outputNo < static_cast<int>(expected.size())) {
+          created.reserve(expected[outputNo]);
+        }
       }
     }
     
@@ -70,7 +117,7 @@ void collectAllFeatures(int frame, int sr,
       
       // Handle timestamp according to output sample type
       if (output.sampleType == Plugin::OutputDescriptor::OneSamplePerStep) {
-        featureTime = RealTime::frame2RealTime(frame, sr);
+        featureTime = frameToRealTime(frame, sr);
       } else if (output.sampleType == Plugin::OutputDescriptor::FixedSampleRate) {
         if (fli->hasTimestamp) {
           featureTime = fli->timestamp;
@@ -80,7 +127,7 @@ void collectAllFeatures(int frame, int sr,
             int increment_ns = static_cast<int>((1000000000.0 / output.sampleRate) + 0.5);
             featureTime = lastFeatureTime[outputNo] + RealTime(0, increment_ns);
           } else {
-            featureTime = RealTime::frame2RealTime(frame, sr);
+            featureTime = frameToRealTime(frame, sr);
           }
           lastFeatureTime[outputNo] = featureTime;
         }
@@ -88,13 +135,19 @@ void collectAllFeatures(int frame, int sr,
         if (fli->hasTimestamp) {
           featureTime = fli->timestamp;
         } else {
-          featureTime = RealTime::frame2RealTime(frame, sr);
+          featureTime = frameToRealTime(frame, sr);
         }
       }
       
+      int64_t featureFrame = realTimeToFrame(featureTime, sr);
+      if (featureFrame < keepFrom || featureFrame >= keepUntil) {
+        continue;
+      }
+      
       // Store timestamp
       if (useFrames) {
-        data.timestamp.push_back(RealTime::realTime2Frame(featureTime, sr));
+        data.timestamp.push_back((frameRate > 0 && frameRate != sr) ?
+                                 realTimeToFrame(featureTime, frameRate) : featureFrame);
       } else {
         data.timestamp.push_back(toSeconds(featureTime));
       }
@@ -110,10 +163,7 @@ void collectAllFeatures(int frame, int sr,
       data.label.push_back(fli->label);
       
       // Store values
-      data.values.push_back(fli->values);
-      if (static_cast<int>(fli->values.size()) > data.numValueCols) {
-        data.numValueCols = fli->values.size();
-      }
+      data.addValues(fli->values);
     }
   }
 }
@@ -242,55 +292,52 @@ DataFrame vampPluginParams(std::string key) {
   return(ret);
 }
 
-// [[Rcpp::export]]
-List runPlugin(std::string key, RObject wave, Nullable<List> params = R_NilValue, bool useFrames = false, Nullable<int> blockSize = R_NilValue, Nullable<int> stepSize = R_NilValue, bool verbose = false)
-{
-  PluginLoader *loader = PluginLoader::getInstance();
+// Audio input for a run: the source and the R vectors it reads from,
+// which must outlive it
+struct RunInput {
+  std::unique_ptr<AudioSource> source;
+  NumericVector left_channel;
+  NumericVector right_channel;
   
-  // Split key into soname and id
-  size_t colonPos = key.find(':');
-  if (colonPos == std::string::npos) {
-    Rcpp::stop("Invalid plugin key format. Expected 'library:plugin'");
-  }
-  std::string soname = key.substr(0, colonPos);
-  std::string id = key.substr(colonPos + 1);
+  // Frame of the original input at which source starts, counted at
+  // the rate of source
+  int64_t origin;
   
-  PluginLoader::PluginKey pluginKey = loader->composePluginKey(soname, id);
+  // Sample rate of the original input, before any resampling
+  int inputRate;
   
-  // Audio file info
-  struct {
-    int samplerate;
-    int64_t frames;
-    int channels;
-  } sfinfo = {0};
+  // Path of the input if it is a file, and the scale applied to the
+  // samples of a Wave object
+  std::string filename;
+  double scale;
   
-  bool useFile = false;
-  std::vector<float> fileData;
-  NumericVector left_channel;
-  NumericVector right_channel;
-  double scale_factor = 1.0;
+  RunInput() : origin(0), inputRate(0), scale(1.0) {}
+};
 
+// Open an S4 Wave object or WAV filename as an AudioSource
+void openInput(RObject wave, RunInput &input)
+{
   if (wave.isS4()) {
       S4 waveObj(wave);
-      sfinfo.samplerate = waveObj.slot("samp.rate");
+      int samplerate = waveObj.slot("samp.rate");
       
-      left_channel = waveObj.slot("left");
-      sfinfo.frames = left_channel.length();
+      input.left_channel = waveObj.slot("left");
+      int64_t frames = input.left_channel.length();
       
       // Check if stereo (right channel exists and has data)
       bool is_stereo = false;
       try {
-        right_channel = waveObj.slot("right");
-        if (right_channel.length() > 0) {
+        input.right_channel = waveObj.slot("right");
+        if (input.right_channel.length() > 0) {
           is_stereo = true;
         }
       } catch(...) {
         // Mono file - right channel doesn't exist
         is_stereo = false;
       }
-      sfinfo.channels = is_stereo ? 2 : 1;
 
       // Check for PCM and bit depth to normalize
+      double scale_factor = 1.0;
       bool pcm = false;
       try {
           pcm = as<bool>(waveObj.slot("pcm"));
@@ -311,30 +358,273 @@ List runPlugin(std::string key, RObject wave, Nullable<List> params = R_NilValue
           else if (bit == 24) scale_factor = 1.0 / 8388608.0;
           else if (bit == 32) scale_factor = 1.0 / 2147483648.0;
       }
+
+      input.scale = scale_factor;
+      input.source.reset(new WaveObjectSource(input.left_channel.begin(),
+                                              is_stereo ? input.right_channel.begin() : nullptr,
+                                              frames, samplerate, scale_factor));
   } else if (is<CharacterVector>(wave)) {
       std::string filename = as<std::string>(wave);
-      SimpleWavReader::Header header;
-      if (!SimpleWavReader::read(filename, fileData, header)) {
-          Rcpp::stop("Failed to read WAV file: " + filename);
-      }
-      sfinfo.samplerate = header.sampleRate;
-      sfinfo.channels = header.channels;
-      sfinfo.frames = fileData.size() / header.channels;
-      useFile = true;
+      // Only the headers are parsed here; the audio is decoded block by
+      // block in the framing loop, unless it is in the audio cache
+      std::string error;
+      input.source = openCachedAudioFile(filename, error);
+      if (!input.source) {
+          Rcpp::Rcerr << error << "\n";
+          std::string format = audioFileFormat(filename);
+          if (format == "unknown") format = "audio";
+          Rcpp::stop("Failed to read " + format + " file: " + filename);
+      }
+      input.filename = filename;
   } else {
       Rcpp::stop("wave argument must be an S4 Wave object or a filename string");
   }
+  input.inputRate = input.source->sampleRate();
+}
+
+// Resample the input to targetRate, if given and different from its
+// own rate. Done before selectRegion(), so that the region starts on a
+// whole frame at the new rate.
+void resampleInput(RunInput &input, Nullable<double> targetRate, bool verbose)
+{
+  if (targetRate.isNull()) return;
+  
+  double value = as<double>(targetRate);
+  if (!(value >= 1) || value > std::numeric_limits<int>::max() || value != std::floor(value)) {
+    Rcpp::stop("targetRate must be a positive whole number of Hz");
+  }
+  int rate = static_cast<int>(value);
+  int inputRate = input.source->sampleRate();
+  if (rate == inputRate) return;
+  
+  std::shared_ptr<const ResamplerBank> bank(new ResamplerBank(inputRate, rate));
+  if (!bank->ok()) {
+    Rcpp::stop("Cannot resample from " + std::to_string(inputRate) + " to " +
+               std::to_string(rate) + " Hz: the ratio between the rates is too fine");
+  }
+  if (verbose) {
+    Rcpp::Rcerr << "Resampling from " << inputRate << " to " << rate << " Hz ("
+                << bank->up() << "/" << bank->down() << ", " << bank->taps()
+                << " taps)" << std::endl;
+  }
+  input.source.reset(new ResampledSource(std::move(input.source), rate, bank));
+}
+
+// Restrict the input to the region [start, end), given in frames of the
+// original input if useFrames is true and in seconds otherwise. Either
+// bound may be null, meaning the start or end of the input. The source
+// is seeked to the start of the region, so nothing before it is decoded.
+void selectRegion(RunInput &input, Nullable<double> start, Nullable<double> end, bool useFrames)
+{
+  if (start.isNull() && end.isNull()) return;
+  
+  AudioSource &source = *input.source;
+  double unit = useFrames ? double(source.sampleRate()) / input.inputRate : source.sampleRate();
+  int64_t frames = source.frames();
+  
+  int64_t begin = 0;
+  int64_t finish = frames;
+  if (start.isNotNull()) {
+    double value = as<double>(start);
+    if (!(value >= 0)) {
+      Rcpp::stop("start must be zero or positive");
+    }
+    begin = std::llround(value * unit);
+  }
+  if (end.isNotNull()) {
+    double value = as<double>(end);
+    if (!(value >= 0)) {
+      Rcpp::stop("end must be zero or positive");
+    }
+    finish = std::min(frames, static_cast<int64_t>(std::llround(std::min(value * unit, 9.0e18))));
+  }
+  if (begin >= frames) {
+    Rcpp::stop("start is beyond the end of the input (" + std::to_string(frames) + " frames)");
+  }
+  if (finish <= begin) {
+    Rcpp::stop("end must be after start");
+  }
+  
+  std::unique_ptr<AudioSource> region(new RegionSource(std::move(input.source), begin, finish));
+  if (!region->seek(0)) {
+    Rcpp::stop("Failed to seek to frame " + std::to_string(begin) + " of the input");
+  }
+  input.source = std::move(region);
+  input.origin = begin;
+}
+
+// Output identifiers from the outputs argument; empty for all outputs
+std::vector<std::string> outputSelection(Nullable<CharacterVector> outputs)
+{
+  std::vector<std::string> ids;
+  if (outputs.isNotNull()) {
+    ids = as<std::vector<std::string>>(outputs);
+    if (ids.empty()) {
+      Rcpp::stop("outputs must name at least one output");
+    }
+  }
+  return ids;
+}
+
+// An initialised plugin and the features it has produced so far.
+// process() and finish() touch no R objects.
+struct PluginRun {
+  std::string key;
+  std::unique_ptr<Plugin> plugin;
+  Plugin::OutputList outputs;
+  int blockSize;
+  int stepSize;
+  int sampleRate;
+  bool useFrames;
+  RealTime adjustment;
+  
+  // Outputs to collect, by index; empty to collect all of them
+  std::vector<bool> wanted;
+  
+  // Number of features each output is expected to produce, by index
+  std::vector<size_t> expected;
+  
+  // Rate of the frames timestamps are counted in with useFrames: that
+  // of the original input, if it has been resampled to sampleRate
+  int frameRate;
+  
+  // Only features timestamped within [keepFrom, keepUntil) are kept
+  int64_t keepFrom;
+  int64_t keepUntil;
   
   // Data structure to collect features for all outputs
-  std::map<int, FeatureData> allFeatureData;
+  std::map<int, FeatureData> featureData;
   
-  std::unique_ptr<Plugin, std::function<void(Plugin*)>> plugin(
-    loader->loadPlugin(pluginKey, sfinfo.samplerate, PluginLoader::ADAPT_ALL_SAFE),
-    [](Plugin* p) { delete p; }
-  );
-  if (!plugin) {
+  // Track time for FixedSampleRate outputs with implicit timestamps
+  std::map<int, RealTime> lastFeatureTime;
+  
+  // If set, featureData is only a buffer: outputs are written out to
+  // the file as they fill, and whatever remains by finish() is left for
+  // the caller to close the file with
+  FeatureFileWriter *writer;
+  
+  // If not negative, the plugin is given only this channel of each block
+  int channel;
+  
+  // If set, the blocks the gate finds silent are not given to the plugin
+  std::unique_ptr<SilenceGate> gate;
+  
+  PluginRun() : writer(nullptr), channel(-1) {}
+
+  // Run the block of input starting at frame start
+  void process(const float *const *block, int64_t start) {
+    if (channel >= 0) block += channel;
+    if (gate) {
+      switch (gate->decide(block, start)) {
+      case SilenceGate::Skip:
+        return;
+      case SilenceGate::Pause:
+        collectRemaining(start);
+        return;
+      case SilenceGate::Resume:
+        // Start afresh, warming up on the held blocks but keeping only
+        // the features from this block on
+        plugin->reset();
+        lastFeatureTime.clear();
+        keepFrom = start;
+        for (const SilenceGate::Held &held : gate->held()) {
+          processBlock(held.pointers.data(), held.start);
+        }
+        break;
+      case SilenceGate::Process:
+        break;
+      }
+    }
+    processBlock(block, start);
+  }
+
+  void processBlock(const float *const *block, int64_t start) {
+    RealTime rt = frameToRealTime(start, sampleRate);
+    Plugin::FeatureSet features = plugin->process(block, rt);
+    collectAllFeatures
+      (realTimeToFrame(rt + adjustment, sampleRate),
+       sampleRate, outputs, features, featureData, useFrames, lastFeatureTime,
+       wanted, expected, keepFrom, keepUntil, frameRate);
+    if (writer) writer->drain(featureData);
+  }
+
+  // Estimate how many features each output will produce from frames
+  // frames of input, so its storage can be reserved up front. Outputs
+  // with variable sample rates, and runs writing to a file, are left to
+  // grow.
+  void expectFrames(int64_t frames) {
+    expected.assign(outputs.size(), 0);
+    if (frames <= 0 || writer) return;
+    for (size_t i = 0; i < outputs.size(); ++i) {
+      if (!wanted.empty() && !wanted[i]) continue;
+      const Plugin::OutputDescriptor &output = outputs[i];
+      double count = 0;
+      if (output.sampleType == Plugin::OutputDescriptor::OneSamplePerStep) {
+        count = double(frames) / stepSize + double(blockSize) / stepSize + 1;
+      } else if (output.sampleType == Plugin::OutputDescriptor::FixedSampleRate &&
+                 output.sampleRate > 0) {
+        count = double(frames) / sampleRate * output.sampleRate + 1;
+      }
+      expected[i] = static_cast<size_t>(std::min(count, double(frames) + 1));
+    }
+  }
+  
+  // Collect remaining features for ALL outputs, end being the frame
+  // following the last block
+  void finish(int64_t end) {
+    if (gate) {
+      gate->finish(end);
+      // If the input ended while skipping, they were collected on pausing
+      if (!gate->processing()) return;
+    }
+    collectRemaining(end);
+  }
+  
+  void collectRemaining(int64_t end) {
+    RealTime rt = frameToRealTime(end, sampleRate);
+    Plugin::FeatureSet features = plugin->getRemainingFeatures();
+    collectAllFeatures
+      (realTimeToFrame(rt + adjustment, sampleRate),
+       sampleRate, outputs, features, featureData, useFrames, lastFeatureTime,
+       wanted, expected, keepFrom, keepUntil, frameRate);
+  }
+};
+
+// Load, configure and initialise a plugin for the given input. Stops on
+// an invalid key, a plugin that cannot be loaded or an unknown output
+// identifier; returns null (after reporting why) if the plugin has no
+// outputs or fails to initialise. If outputIds is not empty only those
+// outputs are collected.
+std::unique_ptr<PluginRun> loadPluginRun(const std::string &key, int sampleRate, int channels,
+                                         Nullable<List> params, bool useFrames,
+                                         Nullable<int> blockSize, Nullable<int> stepSize, bool verbose,
+                                         const std::vector<std::string> &outputIds = std::vector<std::string>())
+{
+  PluginLoader *loader = PluginLoader::getInstance();
+  
+  // Split key into soname and id
+  size_t colonPos = key.find(':');
+  if (colonPos == std::string::npos) {
+    Rcpp::stop("Invalid plugin key format. Expected 'library:plugin'");
+  }
+  std::string soname = key.substr(0, colonPos);
+  std::string id = key.substr(colonPos + 1);
+  
+  PluginLoader::PluginKey pluginKey = loader->composePluginKey(soname, id);
+  
+  std::unique_ptr<PluginRun> run(new PluginRun);
+  run->key = key;
+  run->sampleRate = sampleRate;
+  run->useFrames = useFrames;
+  run->frameRate = sampleRate;
+  run->adjustment = RealTime::zeroTime;
+  run->keepFrom = std::numeric_limits<int64_t>::min();
+  run->keepUntil = std::numeric_limits<int64_t>::max();
+  run->plugin.reset(loader->loadPlugin(pluginKey, sampleRate, PluginLoader::ADAPT_ALL_SAFE));
+  if (!run->plugin) {
     Rcpp::stop("Failed to load plugin '" + key + "'");
   }
+  Plugin *plugin = run->plugin.get();
   
   if (verbose) {
     Rcpp::Rcerr << "Running plugin: \"" << plugin->getIdentifier() << "\"..." << std::endl;
@@ -382,22 +672,8 @@ List runPlugin(std::string key, RObject wave, Nullable<List> params = R_NilValue
     }
     Rcpp::Rcerr << actualBlockSize << std::endl;
   }
-  int overlapSize = actualBlockSize - actualStepSize;
-  int64_t currentStep = 0;
-  int finalStepsRemaining = std::max(1, (actualBlockSize / actualStepSize) - 1);
-  
-  // Use actual channel count from Wave object (PluginChannelAdapter will handle mismatches)
-  int channels = sfinfo.channels;
-  
-  // Use smart pointers for automatic memory management
-  std::unique_ptr<float[]> filebuf(new float[actualBlockSize * channels]);
-  std::vector<std::unique_ptr<float[]>> plugbuf(channels);
-  for (int c = 0; c < channels; ++c) {
-    plugbuf[c].reset(new float[actualBlockSize + 2]);
-  }
-  
-  // Pre-allocate raw pointer array for plugin API (reused each iteration)
-  std::vector<float*> plugbuf_raw(channels);
+  run->blockSize = actualBlockSize;
+  run->stepSize = actualStepSize;
   
   if (verbose) {
     Rcpp::Rcerr << "Using block size = " << actualBlockSize << ", step size = "
@@ -415,24 +691,31 @@ List runPlugin(std::string key, RObject wave, Nullable<List> params = R_NilValue
     Rcpp::Rcerr << "Sound file has " << channels << " (will mix/augment if necessary)" << std::endl;
   }
   
-  Plugin::OutputList outputs = plugin->getOutputDescriptors();
+  run->outputs = plugin->getOutputDescriptors();
   if (verbose) {
-    Rcpp::Rcerr << "Plugin has " << outputs.size() << " output(s)" << std::endl;
+    Rcpp::Rcerr << "Plugin has " << run->outputs.size() << " output(s)" << std::endl;
   }
-  Plugin::FeatureSet features;
   
-  int progress = 0;
-  
-  RealTime rt;
-  PluginWrapper *wrapper = 0;
-  RealTime adjustment = RealTime::zeroTime;
-  
-  int totalSamples = 0;
-  int samplesRead = 0;
-  
-  if (outputs.empty()) {
+  if (run->outputs.empty()) {
     Rcpp::Rcerr << "ERROR: Plugin has no outputs!" << std::endl;
-    return List::create();
+    return nullptr;
+  }
+  
+  if (!outputIds.empty()) {
+    run->wanted.assign(run->outputs.size(), false);
+    for (size_t i = 0; i < outputIds.size(); ++i) {
+      size_t j = 0;
+      while (j < run->outputs.size() && run->outputs[j].identifier != outputIds[i]) ++j;
+      if (j == run->outputs.size()) {
+        std::string available;
+        for (size_t k = 0; k < run->outputs.size(); ++k) {
+          available += (k > 0 ? ", " : "") + run->outputs[k].identifier;
+        }
+        Rcpp::stop("Plugin '" + key + "' has no output '" + outputIds[i] +
+                   "' (available outputs: " + available + ")");
+      }
+      run->wanted[j] = true;
+    }
   }
   
   // Set plugin parameters if provided
@@ -459,187 +742,1588 @@ List runPlugin(std::string key, RObject wave, Nullable<List> params = R_NilValue
     Rcpp::Rcerr << "ERROR: Plugin initialise (channels = " << channels
          << ", stepSize = " << actualStepSize << ", blockSize = "
          << actualBlockSize << ") failed." << std::endl;
-    return List::create();
+    return nullptr;
   }
   
-  wrapper = dynamic_cast<PluginWrapper *>(plugin.get());
+  PluginWrapper *wrapper = dynamic_cast<PluginWrapper *>(plugin);
   if (wrapper) {
     PluginInputDomainAdapter *ida =
       wrapper->getWrapper<PluginInputDomainAdapter>();
-    if (ida) adjustment = ida->getTimestampAdjustment();
+    if (ida) run->adjustment = ida->getTimestampAdjustment();
   }
   
-  totalSamples = (int)sfinfo.frames;
-  samplesRead = 0;
+  // Have the host adapter drop unwanted outputs as it copies features
+  // out of the plugin, so they are never converted at all
+  PluginHostAdapter *host = wrapper ? wrapper->getWrapper<PluginHostAdapter>()
+                                    : dynamic_cast<PluginHostAdapter *>(plugin);
+  if (host) host->setOutputFilter(run->wanted);
   
-  // Track time for FixedSampleRate outputs with implicit timestamps
-  std::map<int, RealTime> lastFeatureTime;
-
-  do {
-    
-    int count=0;
-
-    if ((actualBlockSize==actualStepSize) || (currentStep==0)) {
+  return run;
+}
 
-      // read a full fresh block
-      int samplesToRead = std::min(actualBlockSize, totalSamples - samplesRead);
-      
-      // Put data into filebuf (interleaved for stereo)
-      for (int i = 0; i < samplesToRead; i++) {
-        if (useFile) {
-             for (int c = 0; c < channels; ++c) {
-                 filebuf.get()[i * channels + c] = fileData[(samplesRead + i) * channels + c];
-             }
-        } else {
-            filebuf.get()[i * channels] = left_channel[samplesRead + i] * scale_factor;
-            if (channels == 2) {
-              filebuf.get()[i * channels + 1] = right_channel[samplesRead + i] * scale_factor;
-            }
-        }
-      }
-      // Zero-pad if we don't have enough samples
-      for (int i = samplesToRead; i < actualBlockSize; i++) {
-        filebuf.get()[i * channels] = 0.0f;
-        if (channels == 2) {
-          filebuf.get()[i * channels + 1] = 0.0f;
-        }
-      }
-      
-      count = samplesToRead;
-      samplesRead += count;
-      
-      if (count != actualBlockSize) --finalStepsRemaining;
-    } else {
+// Settings for skipping silence, from the silence arguments of
+// runPlugin()
+struct SilenceSettings {
+  bool enabled;
+  double threshold;  // dBFS
+  double floor;      // Hz, or 0 for the full band
+  double hangover;   // seconds
+  double warmup;     // seconds
+  
+  SilenceSettings() : enabled(false), threshold(0), floor(0), hangover(0), warmup(0) {}
+};
 
-      // otherwise shunt the existing data down and read the remainder.
-      memmove(filebuf.get(), filebuf.get() + (actualStepSize * channels), overlapSize * channels * sizeof(float));
-      
-      int samplesToRead = std::min(actualStepSize, totalSamples - samplesRead);
-      for (int i = 0; i < samplesToRead; i++) {
-        if (useFile) {
-             for (int c = 0; c < channels; ++c) {
-                 filebuf.get()[(overlapSize + i) * channels + c] = fileData[(samplesRead + i) * channels + c];
-             }
-        } else {
-            filebuf.get()[(overlapSize + i) * channels] = left_channel[samplesRead + i] * scale_factor;
-            if (channels == 2) {
-              filebuf.get()[(overlapSize + i) * channels + 1] = right_channel[samplesRead + i] * scale_factor;
-            }
-        }
-      }
-      // Zero-pad if we don't have enough samples
-      for (int i = samplesToRead; i < actualStepSize; i++) {
-        filebuf.get()[(overlapSize + i) * channels] = 0.0f;
-        if (channels == 2) {
-          filebuf.get()[(overlapSize + i) * channels + 1] = 0.0f;
-        }
-      }
-      
-      count = overlapSize + samplesToRead;
-      samplesRead += actualStepSize;
-      
-      if (samplesToRead != actualStepSize) --finalStepsRemaining;
+SilenceSettings silenceSettings(Nullable<double> threshold, Nullable<double> floor,
+                                double hangover, double warmup)
+{
+  SilenceSettings settings;
+  if (threshold.isNull()) return settings;
+  settings.enabled = true;
+  settings.threshold = as<double>(threshold);
+  if (!std::isfinite(settings.threshold)) {
+    Rcpp::stop("silenceThreshold must be a finite level in dBFS");
+  }
+  if (floor.isNotNull()) {
+    settings.floor = as<double>(floor);
+    if (!(settings.floor > 0)) {
+      Rcpp::stop("silenceFloor must be positive");
     }
+  }
+  if (!(hangover >= 0)) {
+    Rcpp::stop("silenceHangover must be zero or positive");
+  }
+  if (!(warmup >= 0)) {
+    Rcpp::stop("warmup must be zero or positive");
+  }
+  settings.hangover = hangover;
+  settings.warmup = warmup;
+  return settings;
+}
 
-    // De-interleave audio data for plugin
-    for (int c = 0; c < channels; ++c) {
-      int j = 0;
-      while (j < count) {
-        plugbuf[c].get()[j] = filebuf.get()[j * channels + c];
-        ++j;
-      }
+// Have run skip the blocks of its input that the settings find silent
+void addSilenceGate(PluginRun &run, int channels, const SilenceSettings &settings)
+{
+  if (!settings.enabled) return;
+  run.gate.reset(new SilenceGate(run.sampleRate, channels, run.blockSize, run.stepSize,
+                                 settings.threshold, settings.floor,
+                                 std::llround(settings.hangover * run.sampleRate),
+                                 std::llround(settings.warmup * run.sampleRate)));
+}
 
-      while (j < actualBlockSize) {
-        plugbuf[c].get()[j] = 0.0f;
-        ++j;
-      }
+// The time ranges a gated run skipped, as a data frame with start and
+// end columns in the same units as its timestamps
+DataFrame skippedRanges(const PluginRun &run)
+{
+  const std::vector<SilenceGate::Range> &ranges = run.gate->skipped();
+  NumericVector start(ranges.size());
+  NumericVector end(ranges.size());
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    RealTime from = frameToRealTime(ranges[i].start, run.sampleRate);
+    RealTime to = frameToRealTime(ranges[i].end, run.sampleRate);
+    if (run.useFrames) {
+      start[i] = double(realTimeToFrame(from, run.frameRate));
+      end[i] = double(realTimeToFrame(to, run.frameRate));
+    } else {
+      start[i] = toSeconds(from);
+      end[i] = toSeconds(to);
     }
+  }
+  return DataFrame::create(Named("start") = start, Named("end") = end);
+}
 
-    rt = RealTime::frame2RealTime(currentStep * actualStepSize, sfinfo.samplerate);
+// Progress and cancellation shared with a thread running runFraming()
+struct FramingControl {
+  std::atomic<int64_t> framesDone;  // frames of the source processed so far
+  std::atomic<bool> cancelled;
+  
+  FramingControl() : framesDone(0), cancelled(false) {}
+};
 
-    // Update raw pointer array (reuse pre-allocated vector)
-    for (int c = 0; c < channels; ++c) {
-      plugbuf_raw[c] = plugbuf[c].get();
+// Periodic saving of the progress of a run by runFraming(), so that a
+// later call can resume it (see Checkpoint). Each save records the
+// features of the run timestamped before the resume frame, warmup
+// frames before the next block, so that resuming from warmup frames
+// before that again lets the plugin settle before the features it has
+// to reproduce; features it had produced from the resume frame on are
+// produced again.
+struct FramingCheckpoint {
+  std::string path;
+  std::string fingerprint;
+  PluginRun *run;
+  int64_t origin;     // first frame of the input to process
+  int64_t warmup;     // in frames
+  double interval;    // seconds between saves
+  std::chrono::steady_clock::time_point last;
+  bool failed;
+  
+  FramingCheckpoint() : run(nullptr), origin(0), warmup(0), interval(0),
+                        last(std::chrono::steady_clock::now()), failed(false) {}
+  
+  // Save the run's progress if it is time to, position being the frame
+  // of the next block
+  void update(int64_t position) {
+    if (failed) return;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (std::chrono::duration<double>(now - last).count() < interval) return;
+    last = now;
+    
+    Checkpoint::State state;
+    state.fingerprint = fingerprint;
+    state.position = position;
+    state.resumeFrom = std::max(origin, position - warmup);
+    
+    // Features are stored in the units of their timestamps
+    RealTime limit = frameToRealTime(state.resumeFrom, run->sampleRate);
+    double stored;
+    if (run->useFrames) {
+      stored = double(run->frameRate != run->sampleRate ?
+                      realTimeToFrame(limit, run->frameRate) : state.resumeFrom);
+    } else {
+      stored = toSeconds(limit);
     }
-    features = plugin->process(plugbuf_raw.data(), rt);
-
-    collectAllFeatures
-      (RealTime::realTime2Frame(rt + adjustment, sfinfo.samplerate),
-       sfinfo.samplerate, outputs, features, allFeatureData, useFrames, lastFeatureTime);
+    
+    // Only the features before resumeFrom are stored; those after it are
+    // reproduced on resuming
+    if (!Checkpoint::store(path, state, run->featureData, stored)) {
+      failed = true;
+      Rcpp::warning("Could not write the checkpoint file " + path);
+    }
+  }
+};
 
-    if (verbose && sfinfo.frames > 0){
+// Frame the input once and feed every run its blocks. Runs with
+// different block and step sizes each get their own framing cursor
+// over the same decoded samples.
+//
+// The source is read from its current position, which is frame offset
+// of the input; block timestamps are reported relative to the input.
+// Runs stop at the first block starting at or after frame stopAt.
+//
+// If control is given, progress is published to it after every block
+// and framing stops early, without collecting the plugins' remaining
+// features, once it is cancelled. Returns false if that happened.
+//
+// If checkpoint is given, the progress of its run is saved to it as
+// often as it asks, after the run's blocks.
+bool runFraming(AudioSource &source, std::vector<PluginRun *> &runs, bool verbose,
+                int64_t offset = 0,
+                int64_t stopAt = std::numeric_limits<int64_t>::max(),
+                FramingControl *control = nullptr,
+                FramingCheckpoint *checkpoint = nullptr)
+{
+  // Samples are decoded straight into the framer's per-channel
+  // buffers and each plugin reads its blocks in place
+  BlockFramer framer(source.channels());
+  for (size_t i = 0; i < runs.size(); ++i) {
+    framer.addCursor(runs[i]->blockSize, runs[i]->stepSize);
+  }
+  
+  // Input already in memory as planar floats, such as a mapped mono
+  // float WAV file, is handed to the plugins in place
+  std::vector<const float *> view(source.channels());
+  int64_t viewFrames;
+  if (source.view(view.data(), viewFrames)) {
+    framer.setView(view.data(), viewFrames);
+  }
+  
+  int64_t frames = source.frames();
+  int progress = 0;
+  int cursor;
+  std::vector<int64_t> processed(runs.size(), 0);
+  
+  int64_t span = frames - source.position();
+  if (stopAt != std::numeric_limits<int64_t>::max()) {
+    span = std::min(span, stopAt - offset);
+  }
+  for (size_t i = 0; i < runs.size(); ++i) {
+    runs[i]->expectFrames(span);
+  }
+  
+  while ((cursor = framer.next(source)) >= 0) {
+    
+    int64_t start = offset + framer.blockStart(cursor);
+    if (start >= stopAt) {
+      framer.finish(cursor);
+      continue;
+    }
+    
+    runs[cursor]->process(framer.block(cursor), start);
+    ++processed[cursor];
+    
+    if (checkpoint && runs[cursor] == checkpoint->run) {
+      checkpoint->update(start + runs[cursor]->stepSize);
+    }
+    
+    if (control) {
+      control->framesDone.store(std::min(span, start - offset + runs[cursor]->stepSize));
+      if (control->cancelled.load()) return false;
+    }
+    
+    if (verbose && span > 0){
       int pp = progress;
-      progress = static_cast<int>((float(currentStep * actualStepSize) / sfinfo.frames) * 100.f + 0.5f);
-      if (progress != pp) {
+      progress = static_cast<int>((float(start - offset) / span) * 100.f + 0.5f);
+      if (progress > pp) {
         Rcpp::Rcerr << "\r" << progress << "%";
+      } else {
+        progress = pp;
       }
     }
-    
-    ++currentStep;
-    
-  } while (finalStepsRemaining > 0);
+  }
   
   if (verbose) {
     Rcpp::Rcerr << "\rDone" << std::endl;
   }
   
-  rt = RealTime::frame2RealTime(currentStep * actualStepSize, sfinfo.samplerate);
+  for (size_t i = 0; i < runs.size(); ++i) {
+    runs[i]->finish(offset + processed[i] * runs[i]->stepSize);
+  }
+  return true;
+}
+
+// Run one plugin over the input as independent time chunks on a thread
+// pool, for plugins whose output depends only on a bounded window of
+// input. Chunk c owns the features timestamped in [c, c + 1) * chunk
+// frames. Each chunk's plugin starts warmup frames before that range
+// and runs on until warmup frames after it, on the same block grid as a
+// single sequential run, and keeps only the features it owns; so the
+// overlaps are de-duplicated by timestamp and the result does not depend
+// on thread timing. Frame 0 of source is frame origin of the input, as
+// for runFraming(), and timestamps in frames are counted at frameRate.
+// Returns false, as loadPluginRun() returns null, if the plugin cannot
+// be initialised.
+bool runChunked(AudioSource &source, int64_t origin, int frameRate,
+                const std::string &key, Nullable<List> params,
+                bool useFrames, Nullable<int> blockSize, Nullable<int> stepSize,
+                const std::vector<std::string> &outputIds,
+                double chunkSeconds, double warmupSeconds, int threads, bool verbose,
+                std::map<int, FeatureData> &featureData)
+{
+  int sampleRate = source.sampleRate();
+  int channels = source.channels();
   
-  features = plugin->getRemainingFeatures();
+  std::unique_ptr<PluginRun> first =
+    loadPluginRun(key, sampleRate, channels, params, useFrames, blockSize, stepSize, verbose,
+                  outputIds);
+  if (!first) return false;
+  first->frameRate = frameRate;
+  int step = first->stepSize;
+  int block = first->blockSize;
   
-  // Collect remaining features for ALL outputs
-  collectAllFeatures(RealTime::realTime2Frame(rt + adjustment, sfinfo.samplerate),
-                     sfinfo.samplerate, outputs, features, allFeatureData, useFrames, lastFeatureTime);
+  int64_t chunkFrames = std::max<int64_t>(step, std::llround(chunkSeconds * sampleRate));
+  int64_t warmupFrames = std::max<int64_t>(0, std::llround(warmupSeconds * sampleRate));
+  int chunks = static_cast<int>(std::max<int64_t>(1, (source.frames() + chunkFrames - 1) / chunkFrames));
   
+  if (chunks == 1) {
+    std::vector<PluginRun *> runs(1, first.get());
+    runFraming(source, runs, verbose, origin);
+    featureData = first->featureData;
+    return true;
+  }
   
-  // Create a List to hold DataFrames for each output
-  List result;
+  int workers = std::min(ThreadPool::threadCount(threads), chunks);
+  if (verbose) {
+    Rcpp::Rcerr << "Processing " << chunks << " chunk(s) of " << chunkFrames
+                << " frames with " << warmupFrames << " frames of warm-up on "
+                << workers << " thread(s)" << std::endl;
+  }
   
-  for (auto &pair : allFeatureData) {
-    FeatureData &featureData = pair.second;
-    
-    DataFrame df;
-    
-    if (featureData.timestamp.empty()) {
-      // No features extracted for this output
-      df = DataFrame::create(
-        Named("timestamp") = NumericVector::create(),
-        Named("duration") = NumericVector::create(),
-        Named("label") = CharacterVector::create()
-      );
-    } else {
-      // Build value columns
-      List valueColumns;
-      std::vector<std::string> colNames(featureData.numValueCols);
-      for (int i = 0; i < featureData.numValueCols; i++) {
-        NumericVector col(featureData.timestamp.size(), NA_REAL);
-        for (size_t j = 0; j < featureData.values.size(); j++) {
-          if (i < static_cast<int>(featureData.values[j].size())) {
-            col[j] = featureData.values[j][i];
+  struct ChunkJob {
+    std::unique_ptr<AudioSource> source;
+    std::unique_ptr<PluginRun> run;
+    int64_t readFrom;
+    int64_t stopAt;
+    std::string error;
+  };
+  std::vector<ChunkJob> jobs(chunks);
+  std::vector<std::map<int, FeatureData>> chunkData(chunks);
+  std::vector<std::string> errors;
+  FramingControl control;
+  CompletionQueue done;
+  ThreadPool pool(workers);
+  
+  int next = 0;
+  int inFlight = 0;
+  int completed = 0;
+  
+  try {
+    while (completed < chunks) {
+      
+      while (next < chunks && inFlight < 2 * workers) {
+        int c = next++;
+        ChunkJob &job = jobs[c];
+        bool last = (c == chunks - 1);
+        int64_t ownStart = c * chunkFrames;
+        int64_t ownEnd = ownStart + chunkFrames;
+        
+        // Start on a multiple of the step size, so that blocks line up
+        // with those of a sequential run, and a further block back, as a
+        // block starting before ownStart can have its feature timestamped
+        // within it (from the middle of the block, for frequency-domain
+        // plugins)
+        job.readFrom = std::max<int64_t>(0, ownStart - warmupFrames - block)
+          / step * step;
+        job.stopAt = last ? std::numeric_limits<int64_t>::max() : origin + ownEnd + warmupFrames;
+        
+        job.source = source.clone();
+        if (!job.source || !job.source->seek(job.readFrom)) {
+          Rcpp::stop("Failed to open a second reader on the input for chunked processing");
+        }
+        
+        if (c == 0) {
+          job.run = std::move(first);
+        } else {
+          job.run = loadPluginRun(key, sampleRate, channels, params, useFrames,
+                                  blockSize, stepSize, false, outputIds);
+          if (!job.run) {
+            Rcpp::stop("Plugin '" + key + "' failed to initialise for chunk " + std::to_string(c + 1));
           }
         }
-        colNames[i] = (featureData.numValueCols > 1) ? "value" + std::to_string(i + 1) : "value";
-        valueColumns[colNames[i]] = col;
+        job.run->frameRate = frameRate;
+        if (c > 0) job.run->keepFrom = origin + ownStart;
+        if (!last) job.run->keepUntil = origin + ownEnd;
+        
+        pool.submit([&job, &done, &control, c, origin]() {
+          try {
+            std::vector<PluginRun *> runs(1, job.run.get());
+            runFraming(*job.source, runs, false, origin + job.readFrom, job.stopAt, &control);
+          } catch (std::exception &e) {
+            job.error = e.what();
+          } catch (...) {
+            job.error = "unknown error";
+          }
+          done.push(c);
+        });
+        ++inFlight;
       }
       
-      // Build the DataFrame
-      List columns;
-      columns["timestamp"] = wrap(featureData.timestamp);
-      columns["duration"] = wrap(featureData.duration);
-      
-      // Add value columns using pre-built names
-      for (int i = 0; i < featureData.numValueCols; i++) {
-        columns[colNames[i]] = valueColumns[colNames[i]];
+      int c;
+      while (!done.pop(c, 100)) {
+        Rcpp::checkUserInterrupt();
       }
+      --inFlight;
+      ++completed;
       
-      columns["label"] = wrap(featureData.label);
+      ChunkJob &job = jobs[c];
+      if (!job.error.empty()) {
+        errors.push_back("chunk " + std::to_string(c + 1) + ": " + job.error);
+      }
+      chunkData[c].swap(job.run->featureData);
+      job.run.reset();
+      job.source.reset();
       
-      df = DataFrame(columns);
+      if (verbose) {
+        Rcpp::Rcerr << "\r" << completed << "/" << chunks << " chunks";
+      }
     }
-    
-    // Use output identifier as name
-    result[featureData.outputIdentifier] = df;
+  } catch (...) {
+    // Stop the chunks in flight at their next block, rather than have
+    // the pool wait for them to run to the end
+    control.cancelled.store(true);
+    throw;
+  }
+  
+  if (verbose) {
+    Rcpp::Rcerr << "\rDone" << std::endl;
   }
   
+  if (!errors.empty()) {
+    Rcpp::stop("Chunked processing failed in " + errors[0]);
+  }
+  
+  // Chunks own consecutive time ranges, so concatenating them in order
+  // gives the features in timestamp order
+  for (int c = 0; c < chunks; ++c) {
+    for (auto &pair : chunkData[c]) {
+      featureData[pair.first].append(pair.second);
+    }
+  }
+  return true;
+}
+
+// Runs framed together by one worker of runFramingGroups(), over the
+// given channels of the input in that order
+struct FramingGroup {
+  std::vector<int> channels;
+  std::vector<PluginRun *> runs;
+};
+
+// Frame the input for each group on a thread of its own, all the groups
+// reading from a single decode of the input shared between them (see
+// SharedDecode), as for runFraming() otherwise. Stops, after every group
+// has finished, if any of them failed, with what describing the work.
+void runFramingGroups(AudioSource &source, std::vector<FramingGroup> &groups,
+                      int64_t origin, bool verbose, const std::string &what)
+{
+  int workers = static_cast<int>(groups.size());
+  
+  struct GroupJob {
+    FramingControl control;
+    std::string error;
+  };
+  std::vector<GroupJob> jobs(workers);
+  
+  SharedDecode shared(source, workers);
+  CompletionQueue done;
+  ThreadPool pool(workers);
+  
+  // All of the workers run at once, as the shared decode needs
+  for (int w = 0; w < workers; ++w) {
+    pool.submit([&groups, &jobs, &shared, &done, w, origin]() {
+      GroupJob &job = jobs[w];
+      try {
+        SharedChannelSource input(shared, w, groups[w].channels);
+        runFraming(input, groups[w].runs, false, origin, std::numeric_limits<int64_t>::max(),
+                   &job.control);
+      } catch (std::exception &e) {
+        job.error = e.what();
+      } catch (...) {
+        job.error = "unknown error";
+      }
+      shared.release(w);
+      done.push(w);
+    });
+  }
+  
+  std::vector<std::string> errors;
+  for (int completed = 0; completed < workers; ) {
+    int w;
+    while (!done.pop(w, 100)) {
+      try {
+        Rcpp::checkUserInterrupt();
+      } catch (...) {
+        // Stop the workers before the pool waits for them
+        for (int i = 0; i < workers; ++i) jobs[i].control.cancelled.store(true);
+        shared.cancel();
+        throw;
+      }
+    }
+    ++completed;
+    if (!jobs[w].error.empty()) {
+      errors.push_back(jobs[w].error);
+    }
+    if (verbose) {
+      Rcpp::Rcerr << "\r" << completed << "/" << workers << " threads done";
+    }
+  }
+  if (verbose) {
+    Rcpp::Rcerr << "\rDone" << std::endl;
+  }
+  if (!errors.empty()) {
+    Rcpp::stop(what + " failed: " + errors[0]);
+  }
+}
+
+// All the channels of an input, in order
+std::vector<int> allChannels(int channels)
+{
+  std::vector<int> all(channels);
+  for (int c = 0; c < channels; ++c) all[c] = c;
+  return all;
+}
+
+// Run one instance of a plugin on each channel of the input, as a mono
+// plugin. The channels are split between up to threads workers, each
+// framing its share of them from a single decode of the input shared by
+// all the workers. Frame 0 of source is frame origin of the input, as
+// for runFraming(), and timestamps in frames are counted at frameRate.
+// Each channel is gated for silence on its own if silence is enabled.
+// The runs are returned in runs, one per channel, with their features.
+// Returns false, as loadPluginRun() returns null, if the plugin cannot
+// be initialised.
+bool runPerChannel(AudioSource &source, int64_t origin, int frameRate,
+                   const std::string &key, Nullable<List> params,
+                   bool useFrames, Nullable<int> blockSize, Nullable<int> stepSize,
+                   const std::vector<std::string> &outputIds, const SilenceSettings &silence,
+                   int threads, bool verbose, std::vector<std::unique_ptr<PluginRun>> &runs)
+{
+  int channels = source.channels();
+  
+  runs.clear();
+  runs.resize(channels);
+  for (int c = 0; c < channels; ++c) {
+    runs[c] = loadPluginRun(key, source.sampleRate(), 1, params, useFrames, blockSize, stepSize,
+                            verbose && c == 0, outputIds);
+    if (!runs[c]) return false;
+    runs[c]->frameRate = frameRate;
+    addSilenceGate(*runs[c], 1, silence);
+  }
+  
+  int workers = std::min(ThreadPool::threadCount(threads), channels);
+  if (verbose) {
+    Rcpp::Rcerr << "Processing " << channels << " channel(s) on "
+                << workers << " thread(s)" << std::endl;
+  }
+  
+  if (workers == 1) {
+    std::vector<PluginRun *> all;
+    for (int c = 0; c < channels; ++c) {
+      runs[c]->channel = c;
+      all.push_back(runs[c].get());
+    }
+    runFraming(source, all, verbose, origin);
+    return true;
+  }
+  
+  // Worker w takes channels w, w + workers, ...
+  std::vector<FramingGroup> groups(workers);
+  for (int c = 0; c < channels; ++c) {
+    FramingGroup &group = groups[c % workers];
+    runs[c]->channel = int(group.channels.size());
+    group.channels.push_back(c);
+    group.runs.push_back(runs[c].get());
+  }
+  runFramingGroups(source, groups, origin, verbose, "Per-channel processing");
+  return true;
+}
+
+// Convert the features of an output with a fixed bin count into a list
+// holding a features x bins matrix of values, filled in one pass from the
+// fixed-stride value buffer
+List featureMatrix(const FeatureData &featureData)
+{
+  int n = static_cast<int>(featureData.size());
+  int bins = featureData.binCount;
+  
+  NumericMatrix values(Rcpp::no_init(n, bins));
+  double *out = values.begin();
+  const float *in = featureData.values.data();
+  for (int j = 0; j < n; j++) {
+    for (int i = 0; i < bins; i++) {
+      out[static_cast<size_t>(i) * n + j] = in[static_cast<size_t>(j) * bins + i];
+    }
+  }
+  
+  return List::create(
+    Named("timestamp") = wrap(featureData.timestamp),
+    Named("duration") = wrap(featureData.duration),
+    Named("values") = values,
+    Named("label") = wrap(featureData.label)
+  );
+}
+
+// Convert the features collected for each output into a named list of
+// data frames, or with asMatrix, of featureMatrix() lists for outputs
+// with a fixed, non-zero bin count
+List featureList(std::map<int, FeatureData> &allFeatureData, bool asMatrix = false)
+{
+  // Create a List to hold DataFrames for each output
+  List result;
+  
+  for (auto &pair : allFeatureData) {
+    FeatureData &featureData = pair.second;
+    
+    if (asMatrix && featureData.binCount > 0) {
+      result[featureData.outputIdentifier] = featureMatrix(featureData);
+      continue;
+    }
+    
+    DataFrame df;
+    
+    if (featureData.timestamp.empty()) {
+      // No features extracted for this output
+      df = DataFrame::create(
+        Named("timestamp") = NumericVector::create(),
+        Named("duration") = NumericVector::create(),
+        Named("label") = CharacterVector::create()
+      );
+    } else {
+      // Build value columns
+      List valueColumns;
+      std::vector<std::string> colNames(featureData.numValueCols);
+      size_t n = featureData.size();
+      for (int i = 0; i < featureData.numValueCols; i++) {
+        NumericVector col;
+        if (featureData.binCount == featureData.numValueCols) {
+          // Fixed layout: a strided walk through the value buffer,
+          // with every cell present
+          col = NumericVector(Rcpp::no_init(n));
+          const float *v = featureData.values.data() + i;
+          for (size_t j = 0; j < n; j++) {
+            col[j] = v[j * featureData.binCount];
+          }
+        } else {
+          col = NumericVector(n, NA_REAL);
+          for (size_t j = 0; j < n; j++) {
+            if (i < featureData.valueCount(j)) {
+              col[j] = featureData.featureValues(j)[i];
+            }
+          }
+        }
+        colNames[i] = (featureData.numValueCols > 1) ? "value" + std::to_string(i + 1) : "value";
+        valueColumns[colNames[i]] = col;
+      }
+      
+      // Build the DataFrame
+      List columns;
+      columns["timestamp"] = wrap(featureData.timestamp);
+      columns["duration"] = wrap(featureData.duration);
+      
+      // Add value columns using pre-built names
+      for (int i = 0; i < featureData.numValueCols; i++) {
+        columns[colNames[i]] = valueColumns[colNames[i]];
+      }
+      
+      columns["label"] = wrap(featureData.label);
+      
+      df = DataFrame(columns);
+    }
+    
+    // Use output identifier as name
+    result[featureData.outputIdentifier] = df;
+  }
+  
+  return result;
+}
+
+// Add everything about the loaded plugin that can change its features
+// to hash: its key and version, the value of every parameter (given or
+// default), the block and step sizes and the outputs collected
+void hashPluginRun(ContentHash &hash, const PluginRun &run,
+                   const std::vector<std::string> &outputIds)
+{
+  Plugin *plugin = run.plugin.get();
+  hash.update(run.key);
+  hash.add(int32_t(plugin->getPluginVersion()));
+  Plugin::ParameterList parameters = plugin->getParameterDescriptors();
+  for (size_t i = 0; i < parameters.size(); ++i) {
+    hash.update(parameters[i].identifier);
+    hash.add(plugin->getParameter(parameters[i].identifier));
+  }
+  hash.add(int32_t(run.blockSize));
+  hash.add(int32_t(run.stepSize));
+  hash.add(uint64_t(outputIds.size()));
+  for (size_t i = 0; i < outputIds.size(); ++i) {
+    hash.update(outputIds[i]);
+  }
+}
+
+// Fingerprint of running the loaded plugin over the input, to tell
+// whether a checkpoint file belongs to the same run. Unlike the result
+// cache key, only the first block of the audio is hashed, with the
+// shape of the input, so that resuming a long run costs no more than a
+// seek; options are the other run options, pre-formatted.
+std::string checkpointFingerprint(const RunInput &input, const PluginRun &run,
+                                  const std::vector<std::string> &outputIds,
+                                  const std::string &options)
+{
+  std::unique_ptr<AudioSource> audio = input.source->clone();
+  if (!audio) {
+    Rcpp::stop("Failed to reopen the input to fingerprint it for the checkpoint");
+  }
+  
+  ContentHash hash;
+  hash.update(std::string("ReVAMP checkpoint 1"));
+  hash.add(int32_t(audio->sampleRate()));
+  hash.add(int32_t(audio->channels()));
+  hash.add(int64_t(audio->frames()));
+  hash.add(int64_t(input.origin));
+  hash.add(int32_t(input.inputRate));
+  
+  const int64_t hashBlock = 65536;
+  int channels = audio->channels();
+  std::vector<std::vector<float>> buffers(channels, std::vector<float>(hashBlock));
+  std::vector<float *> dest(channels);
+  for (int c = 0; c < channels; ++c) dest[c] = buffers[c].data();
+  int64_t got = audio->read(dest.data(), hashBlock);
+  for (int c = 0; c < channels; ++c) {
+    hash.update(buffers[c].data(), got * sizeof(float));
+  }
+  
+  hashPluginRun(hash, run, outputIds);
+  hash.update(options);
+  return hash.hex();
+}
+
+// Add the bytes of the file at filename to hash, through a mapping of
+// the file where it can be mapped. Returns false if it cannot be read.
+bool hashFileContents(ContentHash &hash, const std::string &filename)
+{
+  MappedFile map;
+  if (map.open(filename)) {
+    hash.add(uint64_t(map.size()));
+    hash.update(map.data(), size_t(map.size()));
+    return true;
+  }
+  std::ifstream in(filename.c_str(), std::ios::binary | std::ios::ate);
+  if (!in) return false;
+  hash.add(uint64_t(in.tellg()));
+  in.seekg(0);
+  std::vector<char> buffer(1 << 20);
+  while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0) {
+    hash.update(buffer.data(), size_t(in.gcount()));
+  }
+  return in.eof();
+}
+
+// Path of the result cache file for running the loaded plugin over the
+// input, named by a hash of the input's content and of everything else
+// that can change the features: the plugin key and version, the value
+// of every parameter (given or default), the block and step sizes, the
+// region and the other run options, passed pre-formatted in options.
+//
+// Files are identified by their bytes, wherever and however they are
+// named, and Wave objects by their samples before any resampling, so a
+// lookup never decodes or resamples the audio.
+std::string resultCachePath(const std::string &cacheDir, const RunInput &input,
+                            const PluginRun &run, const std::vector<std::string> &outputIds,
+                            const std::string &options)
+{
+  const AudioSource &audio = *input.source;
+  
+  ContentHash hash;
+  hash.update(std::string("ReVAMP result cache 3"));
+  hash.add(int32_t(audio.sampleRate()));
+  hash.add(int32_t(audio.channels()));
+  hash.add(int64_t(audio.frames()));
+  hash.add(int64_t(input.origin));
+  hash.add(int32_t(input.inputRate));
+  
+  if (!input.filename.empty()) {
+    hash.update(std::string("file"));
+    if (!hashFileContents(hash, input.filename)) {
+      Rcpp::stop("Failed to read " + input.filename + " to identify it for the cache");
+    }
+  } else {
+    hash.update(std::string("wave"));
+    hash.add(input.scale);
+    hash.update(input.left_channel.begin(), input.left_channel.length() * sizeof(double));
+    hash.update(input.right_channel.begin(), input.right_channel.length() * sizeof(double));
+  }
+  
+  hashPluginRun(hash, run, outputIds);
+  hash.update(options);
+  
+  std::string path = cacheDir;
+  if (!path.empty() && path[path.size() - 1] != '/' && path[path.size() - 1] != '\\') {
+    path += '/';
+  }
+  return path + hash.hex() + ".rvc";
+}
+
+// Run the loaded plugin over the input as runFraming() does, saving its
+// progress to the checkpoint file at path every interval seconds, and
+// resuming from that file if it holds the progress of the same run. On
+// resuming, the plugin starts warmup seconds before the point it is to
+// reproduce features from (see FramingCheckpoint). The file is removed
+// once the run is complete.
+void runCheckpointed(AudioSource &source, const RunInput &input, PluginRun &run,
+                     const std::vector<std::string> &outputIds, const std::string &path,
+                     double interval, double warmupSeconds, bool verbose)
+{
+  FramingCheckpoint checkpoint;
+  checkpoint.path = path;
+  checkpoint.run = &run;
+  checkpoint.origin = input.origin;
+  checkpoint.warmup = std::max<int64_t>(0, std::llround(warmupSeconds * source.sampleRate()));
+  checkpoint.interval = interval;
+  
+  std::ostringstream options;
+  options << "useFrames=" << run.useFrames;
+  checkpoint.fingerprint = checkpointFingerprint(input, run, outputIds, options.str());
+  
+  int64_t offset = input.origin;
+  if (Checkpoint::exists(path)) {
+    Checkpoint::State state;
+    if (!Checkpoint::load(path, state)) {
+      Rcpp::stop("Checkpoint file " + path + " is truncated or not a checkpoint file");
+    }
+    if (state.fingerprint != checkpoint.fingerprint) {
+      Rcpp::stop("Checkpoint file " + path +
+                 " was written by a different run; delete it to start again");
+    }
+    
+    // Start on a multiple of the step size, so that blocks line up
+    // with those of the interrupted run, and a further block back, as
+    // features can be timestamped up to a block after the block's start
+    // (from the middle of it, for frequency-domain plugins)
+    int64_t back = checkpoint.warmup + run.blockSize;
+    int64_t readFrom = std::max<int64_t>(0, state.resumeFrom - back - input.origin)
+      / run.stepSize * run.stepSize;
+    if (!source.seek(readFrom)) {
+      Rcpp::stop("Failed to seek in the input to resume from the checkpoint");
+    }
+    offset += readFrom;
+    run.keepFrom = state.resumeFrom;
+    run.featureData.swap(state.features);
+    
+    if (verbose) {
+      Rcpp::Rcerr << "Resuming from checkpoint at "
+                  << toSeconds(frameToRealTime(state.position, source.sampleRate()))
+                  << "s" << std::endl;
+    }
+  }
+  
+  std::vector<PluginRun *> runs(1, &run);
+  runFraming(source, runs, verbose, offset, std::numeric_limits<int64_t>::max(),
+             nullptr, &checkpoint);
+  std::remove(path.c_str());
+}
+
+// Run one instance of the plugin per block size over the input, all
+// of them fed from a single decode and framing pass with a framing
+// cursor of their own, and return their results in a list named by
+// block size. Each resolution is gated for silence on its own if
+// silence is enabled. Block sizes the plugin cannot be initialised with
+// get an empty result, as in runPlugins.
+List runResolutions(AudioSource &source, const RunInput &input, const std::string &key,
+                    Nullable<List> params, bool useFrames, IntegerVector blockSizes,
+                    Nullable<int> stepSize, const std::vector<std::string> &outputIds,
+                    const SilenceSettings &silence, bool verbose, bool matrix)
+{
+  int n = blockSizes.size();
+  if (n == 0) {
+    Rcpp::stop("blockSizes must contain at least one block size");
+  }
+  CharacterVector names(n);
+  for (int i = 0; i < n; ++i) {
+    if (blockSizes[i] == NA_INTEGER || blockSizes[i] <= 0) {
+      Rcpp::stop("blockSizes must be positive whole numbers");
+    }
+    for (int j = 0; j < i; ++j) {
+      if (blockSizes[j] == blockSizes[i]) {
+        Rcpp::stop("blockSizes must not contain the same size twice");
+      }
+    }
+    names[i] = "block" + std::to_string(blockSizes[i]);
+  }
+  
+  std::vector<std::unique_ptr<PluginRun>> loaded(n);
+  std::vector<PluginRun *> runs;
+  for (int i = 0; i < n; ++i) {
+    loaded[i] = loadPluginRun(key, source.sampleRate(), source.channels(), params, useFrames,
+                              Nullable<int>(wrap(blockSizes[i])), stepSize, verbose && i == 0,
+                              outputIds);
+    if (!loaded[i]) continue;
+    loaded[i]->frameRate = input.inputRate;
+    addSilenceGate(*loaded[i], source.channels(), silence);
+    runs.push_back(loaded[i].get());
+  }
+  
+  if (!runs.empty()) {
+    runFraming(source, runs, verbose, input.origin);
+  }
+  
+  List result(n);
+  for (int i = 0; i < n; ++i) {
+    if (!loaded[i]) {
+      result[i] = List::create();
+      continue;
+    }
+    List resolution = featureList(loaded[i]->featureData, matrix);
+    if (loaded[i]->gate) resolution.attr("skipped") = skippedRanges(*loaded[i]);
+    result[i] = resolution;
+  }
+  result.attr("names") = names;
+  return result;
+}
+
+// [[Rcpp::export]]
+List runPlugin(std::string key, RObject wave, Nullable<List> params = R_NilValue, bool useFrames = false, Nullable<int> blockSize = R_NilValue, Nullable<int> stepSize = R_NilValue, bool verbose = false, Nullable<double> chunkDuration = R_NilValue, double warmup = 0, int threads = 0, Nullable<double> start = R_NilValue, Nullable<double> end = R_NilValue, Nullable<CharacterVector> outputs = R_NilValue, bool matrix = false, std::string cacheDir = "", Nullable<double> targetRate = R_NilValue, bool perChannel = false, Nullable<double> silenceThreshold = R_NilValue, double silenceHangover = 0.5, Nullable<double> silenceFloor = R_NilValue, Nullable<IntegerVector> blockSizes = R_NilValue, std::string checkpoint = "", double checkpointInterval = 300)
+{
+  std::vector<std::string> outputIds = outputSelection(outputs);
+  
+  RunInput input;
+  openInput(wave, input);
+  resampleInput(input, targetRate, verbose);
+  selectRegion(input, start, end, useFrames);
+  AudioSource &source = *input.source;
+  
+  bool chunked = chunkDuration.isNotNull();
+  double chunkSeconds = 0;
+  if (chunked) {
+    chunkSeconds = as<double>(chunkDuration);
+    if (!(chunkSeconds > 0)) {
+      Rcpp::stop("chunkDuration must be positive");
+    }
+    if (!(warmup >= 0)) {
+      Rcpp::stop("warmup must be zero or positive");
+    }
+  }
+  
+  SilenceSettings silence = silenceSettings(silenceThreshold, silenceFloor, silenceHangover, warmup);
+  if (silence.enabled) {
+    if (chunked) {
+      Rcpp::stop("silenceThreshold cannot be combined with chunkDuration");
+    }
+    if (!cacheDir.empty()) {
+      Rcpp::stop("silenceThreshold cannot be combined with cache");
+    }
+  }
+  
+  bool checkpointed = !checkpoint.empty();
+  if (checkpointed) {
+    if (!(checkpointInterval >= 0)) {
+      Rcpp::stop("checkpointInterval must be zero or positive");
+    }
+    if (!(warmup >= 0)) {
+      Rcpp::stop("warmup must be zero or positive");
+    }
+    if (chunked) {
+      Rcpp::stop("checkpoint cannot be combined with chunkDuration");
+    }
+    if (perChannel) {
+      Rcpp::stop("checkpoint cannot be combined with perChannel");
+    }
+    if (blockSizes.isNotNull()) {
+      Rcpp::stop("checkpoint cannot be combined with blockSizes");
+    }
+    if (silence.enabled) {
+      Rcpp::stop("checkpoint cannot be combined with silenceThreshold");
+    }
+  }
+  
+  if (blockSizes.isNotNull()) {
+    if (blockSize.isNotNull()) {
+      Rcpp::stop("blockSize and blockSizes cannot both be given");
+    }
+    if (chunked) {
+      Rcpp::stop("blockSizes cannot be combined with chunkDuration");
+    }
+    if (!cacheDir.empty()) {
+      Rcpp::stop("blockSizes cannot be combined with cache");
+    }
+    if (perChannel) {
+      Rcpp::stop("blockSizes cannot be combined with perChannel");
+    }
+    return runResolutions(source, input, key, params, useFrames, IntegerVector(blockSizes),
+                          stepSize, outputIds, silence, verbose, matrix);
+  }
+  
+  if (perChannel) {
+    if (chunked) {
+      Rcpp::stop("perChannel cannot be combined with chunkDuration");
+    }
+    if (!cacheDir.empty()) {
+      Rcpp::stop("perChannel cannot be combined with cache");
+    }
+    std::vector<std::unique_ptr<PluginRun>> runs;
+    if (!runPerChannel(source, input.origin, input.inputRate, key, params, useFrames,
+                       blockSize, stepSize, outputIds, silence, threads, verbose, runs)) {
+      return List::create();
+    }
+    List result(runs.size());
+    CharacterVector names(runs.size());
+    for (size_t c = 0; c < runs.size(); ++c) {
+      List channel = featureList(runs[c]->featureData, matrix);
+      if (runs[c]->gate) channel.attr("skipped") = skippedRanges(*runs[c]);
+      result[c] = channel;
+      names[c] = "channel" + std::to_string(c + 1);
+    }
+    result.attr("names") = names;
+    return result;
+  }
+  
+  // The plugin is loaded before the lookup, as the cache key needs its
+  // version, parameter defaults and preferred block and step sizes
+  std::unique_ptr<PluginRun> run;
+  std::string cachePath;
+  if (!cacheDir.empty()) {
+    run = loadPluginRun(key, source.sampleRate(), source.channels(),
+                        params, useFrames, blockSize, stepSize, verbose && !chunked, outputIds);
+    if (!run) {
+      return List::create();
+    }
+    std::ostringstream options;
+    options.precision(17);
+    options << "useFrames=" << useFrames << ";chunk=" << chunkSeconds << ";warmup="
+            << (chunked ? warmup : 0) << ";frames=" << source.frames();
+    if (source.sampleRate() != input.inputRate) {
+      options << ";inputRate=" << input.inputRate;
+    }
+    cachePath = resultCachePath(cacheDir, input, *run, outputIds, options.str());
+    
+    std::map<int, FeatureData> cached;
+    if (FeatureCache::load(cachePath, cached)) {
+      if (verbose) {
+        Rcpp::Rcerr << "Using cached result " << cachePath << std::endl;
+      }
+      return featureList(cached, matrix);
+    }
+  }
+  
+  std::map<int, FeatureData> featureData;
+  if (chunked) {
+    run.reset();
+    if (!runChunked(source, input.origin, input.inputRate, key, params, useFrames,
+                    blockSize, stepSize, outputIds, chunkSeconds, warmup, threads, verbose, featureData)) {
+      return List::create();
+    }
+  } else {
+    if (!run) {
+      run = loadPluginRun(key, source.sampleRate(), source.channels(),
+                          params, useFrames, blockSize, stepSize, verbose, outputIds);
+      if (!run) {
+        return List::create();
+      }
+    }
+    run->frameRate = input.inputRate;
+    addSilenceGate(*run, source.channels(), silence);
+    if (checkpointed) {
+      runCheckpointed(source, input, *run, outputIds, checkpoint, checkpointInterval,
+                      warmup, verbose);
+    } else {
+      std::vector<PluginRun *> runs(1, run.get());
+      runFraming(source, runs, verbose, input.origin);
+    }
+    featureData.swap(run->featureData);
+  }
+  
+  if (!cachePath.empty() && !FeatureCache::store(cachePath, featureData)) {
+    Rcpp::warning("Could not write the result cache file " + cachePath);
+  }
+  
+  List result = featureList(featureData, matrix);
+  if (run && run->gate) {
+    result.attr("skipped") = skippedRanges(*run);
+  }
+  return result;
+}
+
+// [[Rcpp::export]]
+List runPluginToFile(std::string key, RObject wave, std::string path, Nullable<List> params = R_NilValue, bool useFrames = false, Nullable<int> blockSize = R_NilValue, Nullable<int> stepSize = R_NilValue, bool verbose = false, Nullable<double> start = R_NilValue, Nullable<double> end = R_NilValue, Nullable<CharacterVector> outputs = R_NilValue)
+{
+  std::vector<std::string> outputIds = outputSelection(outputs);
+  
+  RunInput input;
+  openInput(wave, input);
+  selectRegion(input, start, end, useFrames);
+  AudioSource &source = *input.source;
+  
+  std::unique_ptr<PluginRun> run =
+    loadPluginRun(key, source.sampleRate(), source.channels(),
+                  params, useFrames, blockSize, stepSize, verbose, outputIds);
+  if (!run) {
+    return List::create();
+  }
+  
+  FeatureFileWriter writer;
+  if (!writer.open(path, source.sampleRate(), useFrames)) {
+    Rcpp::stop("Failed to open feature file for writing: " + path);
+  }
+  run->writer = &writer;
+  for (size_t i = 0; i < run->outputs.size(); ++i) {
+    if (!run->wanted.empty() && !run->wanted[i]) continue;
+    writer.declare(static_cast<int>(i), run->outputs[i].identifier);
+  }
+  
+  std::vector<PluginRun *> runs(1, run.get());
+  runFraming(source, runs, verbose, input.origin);
+  
+  if (!writer.close(run->featureData)) {
+    Rcpp::stop("Failed to write features to " + path);
+  }
+  
+  // Every output the plugin declared is listed, as in the file, with
+  // zero features for those that produced none
+  const std::map<int, FeatureFileWriter::Output> &written = writer.outputs();
+  CharacterVector identifier;
+  NumericVector features;
+  IntegerVector values;
+  for (std::map<int, FeatureFileWriter::Output>::const_iterator it = written.begin();
+       it != written.end(); ++it) {
+    identifier.push_back(it->second.identifier);
+    features.push_back(double(it->second.features));
+    values.push_back(it->second.numValueCols);
+  }
+  
+  return List::create(
+    Named("path") = path,
+    Named("key") = key,
+    Named("sampleRate") = source.sampleRate(),
+    Named("useFrames") = useFrames,
+    Named("outputs") = DataFrame::create(
+      Named("identifier") = identifier,
+      Named("features") = features,
+      Named("values") = values
+    )
+  );
+}
+
+// [[Rcpp::export]]
+List readFeatureFile(std::string path, Nullable<CharacterVector> outputs = R_NilValue, bool matrix = false)
+{
+  std::vector<std::string> outputIds = outputSelection(outputs);
+  std::map<int, FeatureData> featureData;
+  int sampleRate;
+  bool useFrames;
+  std::string error;
+  if (!FeatureFileReader::read(path, outputIds, featureData, sampleRate, useFrames, error)) {
+    Rcpp::stop("Failed to read feature file " + path + ": " + error);
+  }
+  return featureList(featureData, matrix);
+}
+
+// [[Rcpp::export]]
+List runPlugins(std::vector<std::string> keys, RObject wave, Nullable<List> params = R_NilValue, bool useFrames = false, Nullable<IntegerVector> blockSize = R_NilValue, Nullable<IntegerVector> stepSize = R_NilValue, bool verbose = false, bool matrix = false)
+{
+  int n = static_cast<int>(keys.size());
+  if (n == 0) {
+    Rcpp::stop("keys must contain at least one plugin key");
+  }
+  
+  List paramLists;
+  if (params.isNotNull()) {
+    paramLists = List(params);
+    if (paramLists.size() != n) {
+      Rcpp::stop("params must be a list with one element per key");
+    }
+  }
+  
+  IntegerVector blockSizes;
+  IntegerVector stepSizes;
+  if (blockSize.isNotNull()) {
+    blockSizes = IntegerVector(blockSize);
+    if (blockSizes.size() != 1 && blockSizes.size() != n) {
+      Rcpp::stop("blockSize must have length 1 or one element per key");
+    }
+  }
+  if (stepSize.isNotNull()) {
+    stepSizes = IntegerVector(stepSize);
+    if (stepSizes.size() != 1 && stepSizes.size() != n) {
+      Rcpp::stop("stepSize must have length 1 or one element per key");
+    }
+  }
+  
+  RunInput input;
+  openInput(wave, input);
+  AudioSource &source = *input.source;
+  
+  // Plugins that fail to initialise get an empty result, as in runPlugin
+  std::vector<std::unique_ptr<PluginRun>> loaded(n);
+  std::vector<PluginRun *> runs;
+  for (int i = 0; i < n; ++i) {
+    Nullable<List> pluginParams = R_NilValue;
+    if (params.isNotNull()) {
+      SEXP p = paramLists[i];
+      if (!Rf_isNull(p)) pluginParams = Nullable<List>(p);
+    }
+    Nullable<int> bs = R_NilValue;
+    Nullable<int> ss = R_NilValue;
+    if (blockSizes.size() > 0) bs = Nullable<int>(wrap(blockSizes[i % blockSizes.size()]));
+    if (stepSizes.size() > 0) ss = Nullable<int>(wrap(stepSizes[i % stepSizes.size()]));
+    
+    loaded[i] = loadPluginRun(keys[i], source.sampleRate(), source.channels(),
+                              pluginParams, useFrames, bs, ss, verbose);
+    if (loaded[i]) runs.push_back(loaded[i].get());
+  }
+  
+  if (!runs.empty()) {
+    runFraming(source, runs, verbose);
+  }
+  
+  List result(n);
+  for (int i = 0; i < n; ++i) {
+    result[i] = loaded[i] ? featureList(loaded[i]->featureData, matrix) : List::create();
+  }
+  result.names() = wrap(keys);
+  return result;
+}
+
+// [[Rcpp::export]]
+List runPluginBatch(std::vector<std::string> files, std::string key, Nullable<List> params = R_NilValue, bool useFrames = false, Nullable<int> blockSize = R_NilValue, Nullable<int> stepSize = R_NilValue, int threads = 0, bool verbose = false, Nullable<CharacterVector> outputs = R_NilValue, bool matrix = false)
+{
+  std::vector<std::string> outputIds = outputSelection(outputs);
+  
+  int n = static_cast<int>(files.size());
+  List result(n);
+  result.names() = wrap(files);
+  if (n == 0) return result;
+  
+  int workers = std::min(ThreadPool::threadCount(threads), n);
+  if (verbose) {
+    Rcpp::Rcerr << "Running plugin \"" << key << "\" on " << n << " file(s) with "
+                << workers << " thread(s)" << std::endl;
+  }
+  
+  // Each file gets its own plugin instance, loaded here on the main
+  // thread and run on a worker. Only a couple of files per worker are
+  // prepared ahead, so memory stays bounded however many files there are.
+  struct BatchJob {
+    std::unique_ptr<AudioSource> source;
+    std::unique_ptr<PluginRun> run;
+    std::string error;
+  };
+  std::vector<BatchJob> jobs(n);
+  std::vector<std::string> failures;
+  FramingControl control;
+  CompletionQueue done;
+  
+  // Declared last so that it is destroyed (joining its workers) before
+  // the jobs they refer to
+  ThreadPool pool(workers);
+  
+  int next = 0;
+  int inFlight = 0;
+  int completed = 0;
+  
+  try {
+    while (completed < n) {
+      
+      while (next < n && inFlight < 2 * workers) {
+        int i = next++;
+        BatchJob &job = jobs[i];
+        std::string error;
+        job.source = openCachedAudioFile(files[i], error);
+        if (!job.source) {
+          failures.push_back(files[i] + " (" + error + ")");
+          result[i] = R_NilValue;
+          ++completed;
+          continue;
+        }
+        job.run = loadPluginRun(key, job.source->sampleRate(), job.source->channels(),
+                                params, useFrames, blockSize, stepSize, false, outputIds);
+        if (!job.run) {
+          job.source.reset();
+          result[i] = List::create();
+          ++completed;
+          continue;
+        }
+        pool.submit([&job, &done, &control, i]() {
+          try {
+            std::vector<PluginRun *> runs(1, job.run.get());
+            runFraming(*job.source, runs, false, 0, std::numeric_limits<int64_t>::max(), &control);
+          } catch (std::exception &e) {
+            job.error = e.what();
+          } catch (...) {
+            job.error = "unknown error";
+          }
+          done.push(i);
+        });
+        ++inFlight;
+      }
+      
+      if (inFlight == 0) continue;
+      
+      int i;
+      while (!done.pop(i, 100)) {
+        Rcpp::checkUserInterrupt();
+      }
+      --inFlight;
+      ++completed;
+      
+      BatchJob &job = jobs[i];
+      if (job.error.empty()) {
+        result[i] = featureList(job.run->featureData, matrix);
+      } else {
+        failures.push_back(files[i] + " (" + job.error + ")");
+        result[i] = R_NilValue;
+      }
+      // Plugins are deleted here, on the main thread, as they were loaded
+      job.run.reset();
+      job.source.reset();
+      
+      if (verbose) {
+        Rcpp::Rcerr << "\r" << completed << "/" << n << " files";
+      }
+    }
+  } catch (...) {
+    // Stop the files in flight at their next block, rather than have
+    // the pool wait for them to run to the end
+    control.cancelled.store(true);
+    throw;
+  }
+  
+  if (verbose) {
+    Rcpp::Rcerr << "\rDone" << std::endl;
+  }
+  
+  for (size_t i = 0; i < failures.size(); ++i) {
+    Rcpp::warning("Failed to process " + failures[i]);
+  }
+  
+  return result;
+}
+
+// [[Rcpp::export]]
+List runPluginSweep(std::string key, RObject wave, List paramSets, bool useFrames = false, Nullable<int> blockSize = R_NilValue, Nullable<int> stepSize = R_NilValue, int threads = 0, bool verbose = false, Nullable<double> start = R_NilValue, Nullable<double> end = R_NilValue, Nullable<CharacterVector> outputs = R_NilValue, bool matrix = false)
+{
+  std::vector<std::string> outputIds = outputSelection(outputs);
+  
+  int n = static_cast<int>(paramSets.size());
+  List result(n);
+  if (n == 0) return result;
+  
+  RunInput input;
+  openInput(wave, input);
+  selectRegion(input, start, end, useFrames);
+  AudioSource &source = *input.source;
+  
+  // One plugin instance per parameter set, loaded here on the main
+  // thread. Sets the plugin cannot be initialised with get an empty
+  // result, as in runPlugins.
+  std::vector<std::unique_ptr<PluginRun>> loaded(n);
+  std::vector<PluginRun *> runs;
+  for (int i = 0; i < n; ++i) {
+    Nullable<List> setParams = R_NilValue;
+    SEXP p = paramSets[i];
+    if (!Rf_isNull(p)) setParams = Nullable<List>(p);
+    loaded[i] = loadPluginRun(key, source.sampleRate(), source.channels(), setParams,
+                              useFrames, blockSize, stepSize, verbose && i == 0, outputIds);
+    if (loaded[i]) {
+      loaded[i]->frameRate = input.inputRate;
+      runs.push_back(loaded[i].get());
+    }
+  }
+  
+  int workers = std::min(ThreadPool::threadCount(threads), std::max(int(runs.size()), 1));
+  if (verbose) {
+    Rcpp::Rcerr << "Running " << runs.size() << " parameter set(s) on "
+                << workers << " thread(s)" << std::endl;
+  }
+  
+  if (workers == 1) {
+    if (!runs.empty()) {
+      runFraming(source, runs, verbose, input.origin);
+    }
+  } else {
+    // Worker w takes the instances w, w + workers, ..., each of them
+    // reading every channel
+    std::vector<FramingGroup> groups(workers);
+    for (size_t r = 0; r < runs.size(); ++r) {
+      FramingGroup &group = groups[r % workers];
+      group.runs.push_back(runs[r]);
+    }
+    for (int w = 0; w < workers; ++w) {
+      groups[w].channels = allChannels(source.channels());
+    }
+    runFramingGroups(source, groups, input.origin, verbose, "Parameter sweep");
+  }
+  
+  for (int i = 0; i < n; ++i) {
+    result[i] = loaded[i] ? featureList(loaded[i]->featureData, matrix) : List::create();
+    loaded[i].reset();
+  }
+  return result;
+}
+
+// [[Rcpp::export]]
+DataFrame vampAudioInfo(std::vector<std::string> paths, int threads = 0)
+{
+  int n = static_cast<int>(paths.size());
+  std::vector<AudioFileInfo> info(n);
+  
+  if (n > 0) {
+    // Workers only fill in info; the data frame is built once all are done
+    CompletionQueue done;
+    ThreadPool pool(std::min(ThreadPool::threadCount(threads), n));
+    for (int i = 0; i < n; ++i) {
+      pool.submit([&paths, &info, &done, i]() {
+        info[i] = probeAudioFile(paths[i]);
+        done.push(i);
+      });
+    }
+    for (int completed = 0; completed < n; ++completed) {
+      int i;
+      while (!done.pop(i, 100)) {
+        Rcpp::checkUserInterrupt();
+      }
+    }
+  }
+  
+  StringVector format(n), error(n);
+  IntegerVector sampleRate(n), channels(n), bits(n);
+  NumericVector frames(n), duration(n);
+  for (int i = 0; i < n; ++i) {
+    const AudioFileInfo &file = info[i];
+    format[i] = file.format;
+    if (file.error.empty()) {
+      error[i] = NA_STRING;
+      sampleRate[i] = file.sampleRate;
+      channels[i] = file.channels;
+      bits[i] = file.bitsPerSample;
+      frames[i] = static_cast<double>(file.frames);
+      duration[i] = static_cast<double>(file.frames) / file.sampleRate;
+    } else {
+      error[i] = file.error;
+      sampleRate[i] = NA_INTEGER;
+      channels[i] = NA_INTEGER;
+      bits[i] = NA_INTEGER;
+      frames[i] = NA_REAL;
+      duration[i] = NA_REAL;
+    }
+  }
+  return DataFrame::create(
+    Named("path") = wrap(paths),
+    Named("format") = format,
+    Named("sample.rate") = sampleRate,
+    Named("channels") = channels,
+    Named("bits") = bits,
+    Named("frames") = frames,
+    Named("duration") = duration,
+    Named("error") = error
+  );
+}
+
+// [[Rcpp::export]]
+List vampAudioCache(Nullable<double> maxBytes = R_NilValue, bool clear = false)
+{
+  AudioCache &cache = AudioCache::instance();
+  if (maxBytes.isNotNull()) {
+    double bytes = as<double>(maxBytes);
+    if (!(bytes >= 0)) {
+      Rcpp::stop("maxBytes must be zero or positive");
+    }
+    cache.setBudget(static_cast<size_t>(std::min(bytes, double(SIZE_MAX / 2))));
+  }
+  if (clear) cache.clear();
+  
+  AudioCache::Stats stats = cache.stats();
+  return List::create(
+    Named("maxBytes") = static_cast<double>(stats.budget),
+    Named("bytes") = static_cast<double>(stats.bytes),
+    Named("files") = static_cast<int>(stats.files),
+    Named("hits") = static_cast<double>(stats.hits),
+    Named("misses") = static_cast<double>(stats.misses)
+  );
+}
+
+// A plugin run on a thread of its own, for runPluginAsync(). While the
+// job is running only the worker touches the source and the plugin;
+// the input vectors are released, the plugin deleted and the results
+// converted on the main thread, when the job is collected or garbage
+// collected.
+struct AsyncJob {
+  enum State { Running, Done, Failed, Cancelled };
+  
+  RunInput input;
+  std::unique_ptr<PluginRun> run;
+  bool matrix;
+  bool collected;
+  int64_t frames;
+  FramingControl control;
+  std::atomic<int> state;
+  std::string error;  // set by the worker before it leaves Running
+  std::mutex mutex;
+  std::condition_variable finished;
+  std::thread worker;
+  
+  AsyncJob() : matrix(false), collected(false), frames(0), state(Running) {}
+  
+  ~AsyncJob() {
+    control.cancelled = true;
+    if (worker.joinable()) worker.join();
+  }
+  
+  void start() {
+    worker = std::thread([this]() {
+      int result = Done;
+      try {
+        std::vector<PluginRun *> runs(1, run.get());
+        if (!runFraming(*input.source, runs, false, input.origin,
+                        std::numeric_limits<int64_t>::max(), &control)) {
+          result = Cancelled;
+        }
+      } catch (std::exception &e) {
+        error = e.what();
+        result = Failed;
+      } catch (...) {
+        error = "unknown error";
+        result = Failed;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        state = result;
+      }
+      finished.notify_all();
+    });
+  }
+  
+  // Wait up to timeoutMs for the job to stop running. Returns false on
+  // timeout, so the caller can check for a user interrupt.
+  bool wait(int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return finished.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                             [this] { return state != Running; });
+  }
+};
+
+AsyncJob *asyncJob(SEXP job)
+{
+  XPtr<AsyncJob> ptr(job);
+  if (!ptr.get()) {
+    Rcpp::stop("Invalid or expired job handle");
+  }
+  return ptr.get();
+}
+
+// [[Rcpp::export]]
+SEXP runPluginAsync(std::string key, RObject wave, Nullable<List> params = R_NilValue, bool useFrames = false, Nullable<int> blockSize = R_NilValue, Nullable<int> stepSize = R_NilValue, Nullable<double> start = R_NilValue, Nullable<double> end = R_NilValue, Nullable<CharacterVector> outputs = R_NilValue, bool matrix = false)
+{
+  std::vector<std::string> outputIds = outputSelection(outputs);
+  
+  // Everything that can fail is done here, so that errors are reported
+  // by this call rather than when the job is collected
+  std::unique_ptr<AsyncJob> job(new AsyncJob);
+  openInput(wave, job->input);
+  selectRegion(job->input, start, end, useFrames);
+  AudioSource &source = *job->input.source;
+  job->matrix = matrix;
+  job->frames = source.frames();
+  job->run = loadPluginRun(key, source.sampleRate(), source.channels(),
+                           params, useFrames, blockSize, stepSize, false, outputIds);
+  if (job->run) {
+    job->start();
+  } else {
+    job->state = AsyncJob::Done;
+  }
+  
+  return XPtr<AsyncJob>(job.release(), true);
+}
+
+// [[Rcpp::export]]
+std::string vampJobStatus(SEXP job)
+{
+  switch (asyncJob(job)->state.load()) {
+  case AsyncJob::Running: return "running";
+  case AsyncJob::Done: return "done";
+  case AsyncJob::Failed: return "failed";
+  default: return "cancelled";
+  }
+}
+
+// [[Rcpp::export]]
+double vampJobProgress(SEXP job)
+{
+  AsyncJob *j = asyncJob(job);
+  if (j->state.load() == AsyncJob::Done || j->frames <= 0) return 1.0;
+  return double(j->control.framesDone.load()) / j->frames;
+}
+
+// [[Rcpp::export]]
+bool vampJobCancel(SEXP job)
+{
+  AsyncJob *j = asyncJob(job);
+  j->control.cancelled = true;
+  return j->state.load() == AsyncJob::Running;
+}
+
+// [[Rcpp::export]]
+List vampJobCollect(SEXP job)
+{
+  AsyncJob *j = asyncJob(job);
+  while (!j->wait(100)) {
+    Rcpp::checkUserInterrupt();
+  }
+  if (j->worker.joinable()) j->worker.join();
+  
+  if (j->collected) {
+    Rcpp::stop("Job results have already been collected");
+  }
+  if (j->state.load() == AsyncJob::Failed) {
+    Rcpp::stop("Plugin run failed: " + j->error);
+  }
+  if (j->state.load() == AsyncJob::Cancelled) {
+    Rcpp::stop("Job was cancelled");
+  }
+  
+  List result = j->run ? featureList(j->run->featureData, j->matrix) : List::create();
+  
+  // Release the plugin and input now rather than when the handle is
+  // garbage collected
+  j->collected = true;
+  j->run.reset();
+  j->input.source.reset();
+  j->input.left_channel = NumericVector();
+  j->input.right_channel = NumericVector();
   return result;
 }
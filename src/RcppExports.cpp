@@ -52,8 +52,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // runPlugin
-List runPlugin(std::string key, RObject wave, Nullable<List> params, bool useFrames, Nullable<int> blockSize, Nullable<int> stepSize, bool verbose);
-RcppExport SEXP _ReVAMP_runPlugin(SEXP keySEXP, SEXP waveSEXP, SEXP paramsSEXP, SEXP useFramesSEXP, SEXP blockSizeSEXP, SEXP stepSizeSEXP, SEXP verboseSEXP) {
+List runPlugin(std::string key, RObject wave, Nullable<List> params, bool useFrames, Nullable<int> blockSize, Nullable<int> stepSize, bool verbose, Nullable<double> chunkDuration, double warmup, int threads, Nullable<double> start, Nullable<double> end, Nullable<CharacterVector> outputs, bool matrix, std::string cacheDir, Nullable<double> targetRate, bool perChannel, Nullable<double> silenceThreshold, double silenceHangover, Nullable<double> silenceFloor, Nullable<IntegerVector> blockSizes, std::string checkpoint, double checkpointInterval);
+RcppExport SEXP _ReVAMP_runPlugin(SEXP keySEXP, SEXP waveSEXP, SEXP paramsSEXP, SEXP useFramesSEXP, SEXP blockSizeSEXP, SEXP stepSizeSEXP, SEXP verboseSEXP, SEXP chunkDurationSEXP, SEXP warmupSEXP, SEXP threadsSEXP, SEXP startSEXP, SEXP endSEXP, SEXP outputsSEXP, SEXP matrixSEXP, SEXP cacheDirSEXP, SEXP targetRateSEXP, SEXP perChannelSEXP, SEXP silenceThresholdSEXP, SEXP silenceHangoverSEXP, SEXP silenceFloorSEXP, SEXP blockSizesSEXP, SEXP checkpointSEXP, SEXP checkpointIntervalSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -64,7 +64,205 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< Nullable<int> >::type blockSize(blockSizeSEXP);
     Rcpp::traits::input_parameter< Nullable<int> >::type stepSize(stepSizeSEXP);
     Rcpp::traits::input_parameter< bool >::type verbose(verboseSEXP);
-    rcpp_result_gen = Rcpp::wrap(runPlugin(key, wave, params, useFrames, blockSize, stepSize, verbose));
+    Rcpp::traits::input_parameter< Nullable<double> >::type chunkDuration(chunkDurationSEXP);
+    Rcpp::traits::input_parameter< double >::type warmup(warmupSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< Nullable<double> >::type start(startSEXP);
+    Rcpp::traits::input_parameter< Nullable<double> >::type end(endSEXP);
+    Rcpp::traits::input_parameter< Nullable<CharacterVector> >::type outputs(outputsSEXP);
+    Rcpp::traits::input_parameter< bool >::type matrix(matrixSEXP);
+    Rcpp::traits::input_parameter< std::string >::type cacheDir(cacheDirSEXP);
+    Rcpp::traits::input_parameter< Nullable<double> >::type targetRate(targetRateSEXP);
+    Rcpp::traits::input_parameter< bool >::type perChannel(perChannelSEXP);
+    Rcpp::traits::input_parameter< Nullable<double> >::type silenceThreshold(silenceThresholdSEXP);
+    Rcpp::traits::input_parameter< double >::type silenceHangover(silenceHangoverSEXP);
+    Rcpp::traits::input_parameter< Nullable<double> >::type silenceFloor(silenceFloorSEXP);
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type blockSizes(blockSizesSEXP);
+    Rcpp::traits::input_parameter< std::string >::type checkpoint(checkpointSEXP);
+    Rcpp::traits::input_parameter< double >::type checkpointInterval(checkpointIntervalSEXP);
+    rcpp_result_gen = Rcpp::wrap(runPlugin(key, wave, params, useFrames, blockSize, stepSize, verbose, chunkDuration, warmup, threads, start, end, outputs, matrix, cacheDir, targetRate, perChannel, silenceThreshold, silenceHangover, silenceFloor, blockSizes, checkpoint, checkpointInterval));
+    return rcpp_result_gen;
+END_RCPP
+}
+// runPluginToFile
+List runPluginToFile(std::string key, RObject wave, std::string path, Nullable<List> params, bool useFrames, Nullable<int> blockSize, Nullable<int> stepSize, bool verbose, Nullable<double> start, Nullable<double> end, Nullable<CharacterVector> outputs);
+RcppExport SEXP _ReVAMP_runPluginToFile(SEXP keySEXP, SEXP waveSEXP, SEXP pathSEXP, SEXP paramsSEXP, SEXP useFramesSEXP, SEXP blockSizeSEXP, SEXP stepSizeSEXP, SEXP verboseSEXP, SEXP startSEXP, SEXP endSEXP, SEXP outputsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type key(keySEXP);
+    Rcpp::traits::input_parameter< RObject >::type wave(waveSEXP);
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< Nullable<List> >::type params(paramsSEXP);
+    Rcpp::traits::input_parameter< bool >::type useFrames(useFramesSEXP);
+    Rcpp::traits::input_parameter< Nullable<int> >::type blockSize(blockSizeSEXP);
+    Rcpp::traits::input_parameter< Nullable<int> >::type stepSize(stepSizeSEXP);
+    Rcpp::traits::input_parameter< bool >::type verbose(verboseSEXP);
+    Rcpp::traits::input_parameter< Nullable<double> >::type start(startSEXP);
+    Rcpp::traits::input_parameter< Nullable<double> >::type end(endSEXP);
+    Rcpp::traits::input_parameter< Nullable<CharacterVector> >::type outputs(outputsSEXP);
+    rcpp_result_gen = Rcpp::wrap(runPluginToFile(key, wave, path, params, useFrames, blockSize, stepSize, verbose, start, end, outputs));
+    return rcpp_result_gen;
+END_RCPP
+}
+// readFeatureFile
+List readFeatureFile(std::string path, Nullable<CharacterVector> outputs, bool matrix);
+RcppExport SEXP _ReVAMP_readFeatureFile(SEXP pathSEXP, SEXP outputsSEXP, SEXP matrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< Nullable<CharacterVector> >::type outputs(outputsSEXP);
+    Rcpp::traits::input_parameter< bool >::type matrix(matrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(readFeatureFile(path, outputs, matrix));
+    return rcpp_result_gen;
+END_RCPP
+}
+// runPlugins
+List runPlugins(std::vector<std::string> keys, RObject wave, Nullable<List> params, bool useFrames, Nullable<IntegerVector> blockSize, Nullable<IntegerVector> stepSize, bool verbose, bool matrix);
+RcppExport SEXP _ReVAMP_runPlugins(SEXP keysSEXP, SEXP waveSEXP, SEXP paramsSEXP, SEXP useFramesSEXP, SEXP blockSizeSEXP, SEXP stepSizeSEXP, SEXP verboseSEXP, SEXP matrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type keys(keysSEXP);
+    Rcpp::traits::input_parameter< RObject >::type wave(waveSEXP);
+    Rcpp::traits::input_parameter< Nullable<List> >::type params(paramsSEXP);
+    Rcpp::traits::input_parameter< bool >::type useFrames(useFramesSEXP);
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type blockSize(blockSizeSEXP);
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type stepSize(stepSizeSEXP);
+    Rcpp::traits::input_parameter< bool >::type verbose(verboseSEXP);
+    Rcpp::traits::input_parameter< bool >::type matrix(matrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(runPlugins(keys, wave, params, useFrames, blockSize, stepSize, verbose, matrix));
+    return rcpp_result_gen;
+END_RCPP
+}
+// runPluginBatch
+List runPluginBatch(std::vector<std::string> files, std::string key, Nullable<List> params, bool useFrames, Nullable<int> blockSize, Nullable<int> stepSize, int threads, bool verbose, Nullable<CharacterVector> outputs, bool matrix);
+RcppExport SEXP _ReVAMP_runPluginBatch(SEXP filesSEXP, SEXP keySEXP, SEXP paramsSEXP, SEXP useFramesSEXP, SEXP blockSizeSEXP, SEXP stepSizeSEXP, SEXP threadsSEXP, SEXP verboseSEXP, SEXP outputsSEXP, SEXP matrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type files(filesSEXP);
+    Rcpp::traits::input_parameter< std::string >::type key(keySEXP);
+    Rcpp::traits::input_parameter< Nullable<List> >::type params(paramsSEXP);
+    Rcpp::traits::input_parameter< bool >::type useFrames(useFramesSEXP);
+    Rcpp::traits::input_parameter< Nullable<int> >::type blockSize(blockSizeSEXP);
+    Rcpp::traits::input_parameter< Nullable<int> >::type stepSize(stepSizeSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type verbose(verboseSEXP);
+    Rcpp::traits::input_parameter< Nullable<CharacterVector> >::type outputs(outputsSEXP);
+    Rcpp::traits::input_parameter< bool >::type matrix(matrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(runPluginBatch(files, key, params, useFrames, blockSize, stepSize, threads, verbose, outputs, matrix));
+    return rcpp_result_gen;
+END_RCPP
+}
+// runPluginSweep
+List runPluginSweep(std::string key, RObject wave, List paramSets, bool useFrames, Nullable<int> blockSize, Nullable<int> stepSize, int threads, bool verbose, Nullable<double> start, Nullable<double> end, Nullable<CharacterVector> outputs, bool matrix);
+RcppExport SEXP _ReVAMP_runPluginSweep(SEXP keySEXP, SEXP waveSEXP, SEXP paramSetsSEXP, SEXP useFramesSEXP, SEXP blockSizeSEXP, SEXP stepSizeSEXP, SEXP threadsSEXP, SEXP verboseSEXP, SEXP startSEXP, SEXP endSEXP, SEXP outputsSEXP, SEXP matrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type key(keySEXP);
+    Rcpp::traits::input_parameter< RObject >::type wave(waveSEXP);
+    Rcpp::traits::input_parameter< List >::type paramSets(paramSetsSEXP);
+    Rcpp::traits::input_parameter< bool >::type useFrames(useFramesSEXP);
+    Rcpp::traits::input_parameter< Nullable<int> >::type blockSize(blockSizeSEXP);
+    Rcpp::traits::input_parameter< Nullable<int> >::type stepSize(stepSizeSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type verbose(verboseSEXP);
+    Rcpp::traits::input_parameter< Nullable<double> >::type start(startSEXP);
+    Rcpp::traits::input_parameter< Nullable<double> >::type end(endSEXP);
+    Rcpp::traits::input_parameter< Nullable<CharacterVector> >::type outputs(outputsSEXP);
+    Rcpp::traits::input_parameter< bool >::type matrix(matrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(runPluginSweep(key, wave, paramSets, useFrames, blockSize, stepSize, threads, verbose, start, end, outputs, matrix));
+    return rcpp_result_gen;
+END_RCPP
+}
+// vampAudioInfo
+DataFrame vampAudioInfo(std::vector<std::string> paths, int threads);
+RcppExport SEXP _ReVAMP_vampAudioInfo(SEXP pathsSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type paths(pathsSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(vampAudioInfo(paths, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// vampAudioCache
+List vampAudioCache(Nullable<double> maxBytes, bool clear);
+RcppExport SEXP _ReVAMP_vampAudioCache(SEXP maxBytesSEXP, SEXP clearSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Nullable<double> >::type maxBytes(maxBytesSEXP);
+    Rcpp::traits::input_parameter< bool >::type clear(clearSEXP);
+    rcpp_result_gen = Rcpp::wrap(vampAudioCache(maxBytes, clear));
+    return rcpp_result_gen;
+END_RCPP
+}
+// runPluginAsync
+SEXP runPluginAsync(std::string key, RObject wave, Nullable<List> params, bool useFrames, Nullable<int> blockSize, Nullable<int> stepSize, Nullable<double> start, Nullable<double> end, Nullable<CharacterVector> outputs, bool matrix);
+RcppExport SEXP _ReVAMP_runPluginAsync(SEXP keySEXP, SEXP waveSEXP, SEXP paramsSEXP, SEXP useFramesSEXP, SEXP blockSizeSEXP, SEXP stepSizeSEXP, SEXP startSEXP, SEXP endSEXP, SEXP outputsSEXP, SEXP matrixSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type key(keySEXP);
+    Rcpp::traits::input_parameter< RObject >::type wave(waveSEXP);
+    Rcpp::traits::input_parameter< Nullable<List> >::type params(paramsSEXP);
+    Rcpp::traits::input_parameter< bool >::type useFrames(useFramesSEXP);
+    Rcpp::traits::input_parameter< Nullable<int> >::type blockSize(blockSizeSEXP);
+    Rcpp::traits::input_parameter< Nullable<int> >::type stepSize(stepSizeSEXP);
+    Rcpp::traits::input_parameter< Nullable<double> >::type start(startSEXP);
+    Rcpp::traits::input_parameter< Nullable<double> >::type end(endSEXP);
+    Rcpp::traits::input_parameter< Nullable<CharacterVector> >::type outputs(outputsSEXP);
+    Rcpp::traits::input_parameter< bool >::type matrix(matrixSEXP);
+    rcpp_result_gen = Rcpp::wrap(runPluginAsync(key, wave, params, useFrames, blockSize, stepSize, start, end, outputs, matrix));
+    return rcpp_result_gen;
+END_RCPP
+}
+// vampJobStatus
+std::string vampJobStatus(SEXP job);
+RcppExport SEXP _ReVAMP_vampJobStatus(SEXP jobSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type job(jobSEXP);
+    rcpp_result_gen = Rcpp::wrap(vampJobStatus(job));
+    return rcpp_result_gen;
+END_RCPP
+}
+// vampJobProgress
+double vampJobProgress(SEXP job);
+RcppExport SEXP _ReVAMP_vampJobProgress(SEXP jobSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type job(jobSEXP);
+    rcpp_result_gen = Rcpp::wrap(vampJobProgress(job));
+    return rcpp_result_gen;
+END_RCPP
+}
+// vampJobCancel
+bool vampJobCancel(SEXP job);
+RcppExport SEXP _ReVAMP_vampJobCancel(SEXP jobSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type job(jobSEXP);
+    rcpp_result_gen = Rcpp::wrap(vampJobCancel(job));
+    return rcpp_result_gen;
+END_RCPP
+}
+// vampJobCollect
+List vampJobCollect(SEXP job);
+RcppExport SEXP _ReVAMP_vampJobCollect(SEXP jobSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type job(jobSEXP);
+    rcpp_result_gen = Rcpp::wrap(vampJobCollect(job));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -74,7 +272,19 @@ static const R_CallMethodDef CallEntries[] = {
     {"_ReVAMP_vampPaths", (DL_FUNC) &_ReVAMP_vampPaths, 0},
     {"_ReVAMP_vampPlugins", (DL_FUNC) &_ReVAMP_vampPlugins, 0},
     {"_ReVAMP_vampPluginParams", (DL_FUNC) &_ReVAMP_vampPluginParams, 1},
-    {"_ReVAMP_runPlugin", (DL_FUNC) &_ReVAMP_runPlugin, 7},
+    {"_ReVAMP_runPlugin", (DL_FUNC) &_ReVAMP_runPlugin, 23},
+    {"_ReVAMP_runPluginToFile", (DL_FUNC) &_ReVAMP_runPluginToFile, 11},
+    {"_ReVAMP_readFeatureFile", (DL_FUNC) &_ReVAMP_readFeatureFile, 3},
+    {"_ReVAMP_runPlugins", (DL_FUNC) &_ReVAMP_runPlugins, 8},
+    {"_ReVAMP_runPluginBatch", (DL_FUNC) &_ReVAMP_runPluginBatch, 10},
+    {"_ReVAMP_runPluginSweep", (DL_FUNC) &_ReVAMP_runPluginSweep, 12},
+    {"_ReVAMP_vampAudioInfo", (DL_FUNC) &_ReVAMP_vampAudioInfo, 2},
+    {"_ReVAMP_vampAudioCache", (DL_FUNC) &_ReVAMP_vampAudioCache, 2},
+    {"_ReVAMP_runPluginAsync", (DL_FUNC) &_ReVAMP_runPluginAsync, 10},
+    {"_ReVAMP_vampJobStatus", (DL_FUNC) &_ReVAMP_vampJobStatus, 1},
+    {"_ReVAMP_vampJobProgress", (DL_FUNC) &_ReVAMP_vampJobProgress, 1},
+    {"_ReVAMP_vampJobCancel", (DL_FUNC) &_ReVAMP_vampJobCancel, 1},
+    {"_ReVAMP_vampJobCollect", (DL_FUNC) &_ReVAMP_vampJobCollect, 1},
     {NULL, NULL, 0}
 };
 
@@ -0,0 +1,242 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#include "AudioSource.h"
+
+// Polyphase filter bank for converting between two sample rates whose
+// ratio reduces to up/down. Output frame n lies at input position
+// n * down / up; it is the sum of the 2 * half input frames around that
+// position, weighted by the phase (n * down) % up of the bank.
+//
+// The prototype is a Kaiser-windowed sinc with its cutoff just below
+// the lower of the two Nyquist frequencies, so the passband is flat to
+// about 80% of it and aliases are down by about 90 dB. Each phase is
+// scaled to unit gain at DC, and the filter is symmetric about the
+// output position, so the output is not delayed.
+class ResamplerBank {
+public:
+    // Stops short of banks too large to hold, which only rates with
+    // no common factor to speak of need
+    static const int64_t MaxCoefficients = int64_t(1) << 24;
+
+    ResamplerBank(int inputRate, int outputRate) {
+        int64_t a = inputRate, b = outputRate;
+        while (b != 0) { int64_t t = a % b; a = b; b = t; }
+        m_up = outputRate / a;
+        m_down = inputRate / a;
+
+        const double ZeroCrossings = 32;
+        const double Rolloff = 0.9;
+        const double Beta = 9.0;
+        const double cutoff = Rolloff * std::min(1.0, double(m_up) / double(m_down));
+        m_half = int(std::ceil(ZeroCrossings / cutoff));
+        const int taps = 2 * m_half;
+
+        if (int64_t(m_up) * taps > MaxCoefficients) {
+            m_up = 0;
+            return;
+        }
+        m_coefficients.resize(size_t(m_up) * taps);
+
+        const double pi = 3.14159265358979323846;
+        const double norm = besselI0(Beta);
+        for (int p = 0; p < m_up; ++p) {
+            float *h = &m_coefficients[size_t(p) * taps];
+            double sum = 0;
+            for (int k = 0; k < taps; ++k) {
+                // Distance from the output position to input frame
+                // i - half + 1 + k, where i is the frame at or before it
+                double t = double(p) / m_up + (m_half - 1 - k);
+                double x = cutoff * t;
+                double sinc = (x == 0) ? 1.0 : std::sin(pi * x) / (pi * x);
+                double r = t / m_half;
+                double window = (r * r >= 1) ? 0.0 : besselI0(Beta * std::sqrt(1 - r * r)) / norm;
+                double v = cutoff * sinc * window;
+                h[k] = float(v);
+                sum += v;
+            }
+            for (int k = 0; k < taps; ++k) {
+                h[k] = float(h[k] / sum);
+            }
+        }
+    }
+
+    // False if the bank would be too large for these rates
+    bool ok() const { return m_up > 0; }
+
+    int up() const { return m_up; }
+    int down() const { return m_down; }
+    int half() const { return m_half; }
+    int taps() const { return 2 * m_half; }
+
+    const float *phase(int p) const {
+        return &m_coefficients[size_t(p) * taps()];
+    }
+
+private:
+    int m_up;
+    int m_down;
+    int m_half;
+    std::vector<float> m_coefficients;
+
+    static double besselI0(double x) {
+        double sum = 1, term = 1;
+        for (int k = 1; k < 64; ++k) {
+            term *= (x / (2 * k)) * (x / (2 * k));
+            sum += term;
+            if (term < sum * 1e-17) break;
+        }
+        return sum;
+    }
+};
+
+// Another source resampled to a new rate as it is read, so the framing
+// loop and plugins see only the new rate. Frame n of this source is at
+// the same time as frame n * down / up of the underlying one, and the
+// underlying source is taken to be silent outside its own frames.
+//
+// Seeking starts the underlying source a filter's width ahead of the
+// equivalent position, so chunks and regions come out exactly as in a
+// read from the start.
+class ResampledSource : public AudioSource {
+public:
+    // Check that the bank is ok() before wrapping a source with it
+    ResampledSource(std::unique_ptr<AudioSource> source, int rate,
+                    std::shared_ptr<const ResamplerBank> bank) :
+        m_source(std::move(source)), m_rate(rate), m_bank(bank),
+        m_buffers(m_source->channels()), m_position(0) {
+        m_inputFrames = m_source->frames();
+        m_frames = (m_inputFrames * m_bank->up() + m_bank->down() - 1) / m_bank->down();
+        m_bufferStart = inputFrameFor(0);
+        m_sourcePosition = m_source->position();
+    }
+
+    int channels() const { return m_source->channels(); }
+    int sampleRate() const { return m_rate; }
+    int64_t frames() const { return m_frames; }
+
+    int64_t read(float *const *dest, int64_t n) {
+        n = std::max<int64_t>(0, std::min(n, m_frames - m_position));
+        const int up = m_bank->up();
+        const int64_t down = m_bank->down();
+        const int taps = m_bank->taps();
+        int64_t done = 0;
+        while (done < n) {
+            const int64_t count = std::min(n - done, int64_t(BatchSize));
+            const int64_t first = m_position + done;
+            if (!prepare(inputFrameFor(first), inputFrameFor(first + count - 1) + taps)) break;
+            for (int64_t j = 0; j < count; ++j) {
+                const int64_t scaled = (first + j) * down;
+                const float *h = m_bank->phase(int(scaled % up));
+                const size_t offset = size_t(scaled / up - m_bank->half() + 1 - m_bufferStart);
+                for (size_t c = 0; c < m_buffers.size(); ++c) {
+                    const float *x = m_buffers[c].data() + offset;
+                    float sum = 0.f;
+                    for (int k = 0; k < taps; ++k) {
+                        sum += h[k] * x[k];
+                    }
+                    dest[c][done + j] = sum;
+                }
+            }
+            done += count;
+        }
+        m_position += done;
+        return done;
+    }
+
+    bool seek(int64_t frame) {
+        if (frame < 0 || frame > m_frames) return false;
+        const int64_t from = inputFrameFor(frame);
+        if (from < m_bufferStart || from > m_bufferStart + buffered()) {
+            // Nothing buffered is of use; restart the underlying source
+            for (size_t c = 0; c < m_buffers.size(); ++c) m_buffers[c].clear();
+            m_bufferStart = from;
+            int64_t target = std::max<int64_t>(0, std::min(from, m_inputFrames));
+            if (!m_source->seek(target)) return false;
+            m_sourcePosition = target;
+        }
+        m_position = frame;
+        return true;
+    }
+
+    int64_t position() const { return m_position; }
+
+    std::unique_ptr<AudioSource> clone() const {
+        std::unique_ptr<AudioSource> inner = m_source->clone();
+        if (!inner) return nullptr;
+        return std::unique_ptr<AudioSource>(new ResampledSource(std::move(inner), m_rate, m_bank));
+    }
+
+private:
+    static const int64_t BatchSize = 4096;
+
+    std::unique_ptr<AudioSource> m_source;
+    int m_rate;
+    std::shared_ptr<const ResamplerBank> m_bank;
+    int64_t m_inputFrames;
+    int64_t m_frames;
+
+    // Input frames [m_bufferStart, m_bufferStart + buffered()), one
+    // vector per channel, with zeros standing in outside the input
+    std::vector<std::vector<float> > m_buffers;
+    int64_t m_bufferStart;
+    int64_t m_sourcePosition;
+    int64_t m_position;
+    std::vector<float *> m_pointers;
+
+    // The first input frame under the filter for output frame n
+    int64_t inputFrameFor(int64_t n) const {
+        return n * m_bank->down() / m_bank->up() - m_bank->half() + 1;
+    }
+
+    int64_t buffered() const {
+        return m_buffers.empty() ? 0 : int64_t(m_buffers[0].size());
+    }
+
+    // Buffer exactly the input frames [from, to), dropping those before
+    // from and reading on from the underlying source
+    bool prepare(int64_t from, int64_t to) {
+        if (from > m_bufferStart) {
+            const int64_t drop = std::min(from - m_bufferStart, buffered());
+            for (size_t c = 0; c < m_buffers.size(); ++c) {
+                m_buffers[c].erase(m_buffers[c].begin(), m_buffers[c].begin() + drop);
+            }
+            m_bufferStart += drop;
+        }
+        int64_t have = m_bufferStart + buffered();
+        if (have >= to) return true;
+
+        const size_t size = size_t(to - m_bufferStart);
+        for (size_t c = 0; c < m_buffers.size(); ++c) m_buffers[c].resize(size, 0.f);
+
+        // Only the frames inside the input are read; the rest stay zero
+        const int64_t readFrom = std::max<int64_t>(have, 0);
+        const int64_t readTo = std::min(to, m_inputFrames);
+        if (readFrom < readTo) {
+            if (m_sourcePosition != readFrom) {
+                if (!m_source->seek(readFrom)) return false;
+                m_sourcePosition = readFrom;
+            }
+            m_pointers.resize(m_buffers.size());
+            for (size_t c = 0; c < m_buffers.size(); ++c) {
+                m_pointers[c] = m_buffers[c].data() + (readFrom - m_bufferStart);
+            }
+            int64_t got = m_source->read(m_pointers.data(), readTo - readFrom);
+            m_sourcePosition += got;
+            if (got < readTo - readFrom) {
+                // A short read means the input ended early
+                m_inputFrames = m_sourcePosition;
+            }
+        }
+        return true;
+    }
+};
+
+#endif
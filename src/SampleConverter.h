@@ -0,0 +1,443 @@
+#ifndef SAMPLE_CONVERTER_H
+#define SAMPLE_CONVERTER_H
+
+#include <cstring>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define SAMPLE_CONVERTER_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define SAMPLE_CONVERTER_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define SAMPLE_CONVERTER_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Conversion of little-endian WAV sample data to floats in [-1, 1).
+//
+// Each encoding has a scalar kernel and, where the CPU has them, SSE2
+// and AVX2 (x86) or NEON (64-bit ARM) kernels. kernel() picks the best
+// one the running CPU supports, checking once; AVX2 kernels are compiled
+// for that target alone, so the package still runs on CPUs without it.
+// All kernels scale by powers of two, so every one of them gives
+// exactly the same floats as the scalar code.
+//
+// Kernels convert count consecutive samples; input need not be aligned.
+//
+// Converted multichannel samples are then split into one buffer per
+// channel by a splitter, picked once for the channel count in the same
+// way: stereo has its stride fixed at compile time and a vector kernel,
+// other counts use a loop over a runtime stride.
+class SampleConverter {
+public:
+    enum Encoding { UInt8, Int16, Int24, Int32, Float32, Float64 };
+    enum Level { Scalar, SSE2, AVX2, NEON };
+
+    typedef void (*Kernel)(const unsigned char *in, float *out, int64_t count);
+    typedef void (*Splitter)(const float *in, float *const *out, int channels, int64_t frames);
+
+    // Encoding of a WAV format (1 = PCM, 3 = IEEE float) and bit depth;
+    // returns false if there is none
+    static bool encoding(int audioFormat, int bits, Encoding &e) {
+        if (audioFormat == 1) {
+            switch (bits) {
+            case 8: e = UInt8; return true;
+            case 16: e = Int16; return true;
+            case 24: e = Int24; return true;
+            case 32: e = Int32; return true;
+            }
+        } else if (audioFormat == 3) {
+            switch (bits) {
+            case 32: e = Float32; return true;
+            case 64: e = Float64; return true;
+            }
+        }
+        return false;
+    }
+
+    // Most capable level supported by this CPU
+    static Level bestLevel() {
+        static const Level level = detect();
+        return level;
+    }
+
+    static const char *levelName(Level level) {
+        switch (level) {
+        case SSE2: return "sse2";
+        case AVX2: return "avx2";
+        case NEON: return "neon";
+        default: return "scalar";
+        }
+    }
+
+    // Kernel for the encoding at the given level, or at the best level
+    // available if level is not supported by the build and CPU
+    static Kernel kernel(Encoding e, Level level = bestLevel()) {
+        if (level > bestLevel()) level = bestLevel();
+#ifdef SAMPLE_CONVERTER_AVX2
+        if (level == AVX2) {
+            switch (e) {
+            case UInt8: return avx2UInt8;
+            case Int16: return avx2Int16;
+            case Int24: return avx2Int24;
+            case Int32: return avx2Int32;
+            case Float64: return avx2Float64;
+            default: break;
+            }
+        }
+#endif
+#ifdef SAMPLE_CONVERTER_SSE2
+        if (level >= SSE2) {
+            switch (e) {
+            case UInt8: return sse2UInt8;
+            case Int16: return sse2Int16;
+            case Int32: return sse2Int32;
+            case Float64: return sse2Float64;
+            default: break;
+            }
+        }
+#endif
+#ifdef SAMPLE_CONVERTER_NEON
+        if (level == NEON) {
+            switch (e) {
+            case UInt8: return neonUInt8;
+            case Int16: return neonInt16;
+            case Int24: return neonInt24;
+            case Int32: return neonInt32;
+            case Float64: return neonFloat64;
+            default: break;
+            }
+        }
+#endif
+        switch (e) {
+        case UInt8: return scalarUInt8;
+        case Int16: return scalarInt16;
+        case Int24: return scalarInt24;
+        case Int32: return scalarInt32;
+        case Float64: return scalarFloat64;
+        default: return copyFloat32;
+        }
+    }
+
+    // Splitter for the channel count at the given level, or at the best
+    // level available
+    static Splitter splitter(int channels, Level level = bestLevel()) {
+        if (level > bestLevel()) level = bestLevel();
+        if (channels == 2) {
+#ifdef SAMPLE_CONVERTER_SSE2
+            if (level >= SSE2) return sse2Split2;
+#endif
+#ifdef SAMPLE_CONVERTER_NEON
+            if (level == NEON) return neonSplit2;
+#endif
+            return scalarSplit<2>;
+        }
+        return scalarSplit<0>;
+    }
+
+private:
+    static Level detect() {
+#if defined(SAMPLE_CONVERTER_AVX2)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return AVX2;
+        return SSE2;
+#elif defined(SAMPLE_CONVERTER_SSE2)
+        return SSE2;
+#elif defined(SAMPLE_CONVERTER_NEON)
+        return NEON;
+#else
+        return Scalar;
+#endif
+    }
+
+    // Scalar kernels, also used for the tails of the vector kernels
+
+    static void scalarUInt8(const unsigned char *in, float *out, int64_t count) {
+        for (int64_t i = 0; i < count; ++i) {
+            out[i] = (in[i] - 128) * (1.0f / 128.0f);
+        }
+    }
+
+    static void scalarInt16(const unsigned char *in, float *out, int64_t count) {
+        for (int64_t i = 0; i < count; ++i) {
+            int16_t v;
+            std::memcpy(&v, in + i * 2, 2);
+            out[i] = v * (1.0f / 32768.0f);
+        }
+    }
+
+    // The three bytes go into the top of an int32, which sign-extends
+    // them for free; scaling by 2^-31 then gives sample / 2^23
+    static void scalarInt24(const unsigned char *in, float *out, int64_t count) {
+        for (int64_t i = 0; i < count; ++i) {
+            const unsigned char *b = in + i * 3;
+            int32_t v = int32_t((uint32_t(b[0]) << 8) | (uint32_t(b[1]) << 16) |
+                                (uint32_t(b[2]) << 24));
+            out[i] = float(v) * (1.0f / 2147483648.0f);
+        }
+    }
+
+    static void scalarInt32(const unsigned char *in, float *out, int64_t count) {
+        for (int64_t i = 0; i < count; ++i) {
+            int32_t v;
+            std::memcpy(&v, in + i * 4, 4);
+            out[i] = float(v) * (1.0f / 2147483648.0f);
+        }
+    }
+
+    static void copyFloat32(const unsigned char *in, float *out, int64_t count) {
+        std::memcpy(out, in, count * sizeof(float));
+    }
+
+    static void scalarFloat64(const unsigned char *in, float *out, int64_t count) {
+        for (int64_t i = 0; i < count; ++i) {
+            double v;
+            std::memcpy(&v, in + i * 8, 8);
+            out[i] = float(v);
+        }
+    }
+
+    // Channels is the stride if it is known at compile time, 0 if it is
+    // only known at run time
+    template <int Channels>
+    static void scalarSplit(const float *in, float *const *out, int channels, int64_t frames) {
+        const int stride = Channels > 0 ? Channels : channels;
+        for (int c = 0; c < stride; ++c) {
+            const float *src = in + c;
+            float *dest = out[c];
+            for (int64_t i = 0; i < frames; ++i) {
+                dest[i] = src[i * stride];
+            }
+        }
+    }
+
+#ifdef SAMPLE_CONVERTER_SSE2
+    // Four int32s to floats scaled by scale
+    static inline void sse2Store(float *out, __m128i v, __m128 scale) {
+        _mm_storeu_ps(out, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+
+    static void sse2UInt8(const unsigned char *in, float *out, int64_t count) {
+        const __m128i bias = _mm_set1_epi8(char(0x80));
+        const __m128 scale = _mm_set1_ps(1.0f / 128.0f);
+        int64_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            // Flipping the top bit makes the offset bytes signed
+            __m128i b = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)), bias);
+            __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8);
+            __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8);
+            sse2Store(out + i, _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16), scale);
+            sse2Store(out + i + 4, _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16), scale);
+            sse2Store(out + i + 8, _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16), scale);
+            sse2Store(out + i + 12, _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16), scale);
+        }
+        scalarUInt8(in + i, out + i, count - i);
+    }
+
+    static void sse2Int16(const unsigned char *in, float *out, int64_t count) {
+        const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+        int64_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 2));
+            sse2Store(out + i, _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16), scale);
+            sse2Store(out + i + 4, _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16), scale);
+        }
+        scalarInt16(in + i * 2, out + i, count - i);
+    }
+
+    static void sse2Int32(const unsigned char *in, float *out, int64_t count) {
+        const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+        int64_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            sse2Store(out + i, _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 4)), scale);
+        }
+        scalarInt32(in + i * 4, out + i, count - i);
+    }
+
+    static void sse2Float64(const unsigned char *in, float *out, int64_t count) {
+        int64_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(reinterpret_cast<const double *>(in + i * 8)));
+            __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(reinterpret_cast<const double *>(in + i * 8 + 16)));
+            _mm_storeu_ps(out + i, _mm_movelh_ps(lo, hi));
+        }
+        scalarFloat64(in + i * 8, out + i, count - i);
+    }
+
+    // Two loads hold four stereo frames; shuffling takes the even and
+    // odd lanes of the pair
+    static void sse2Split2(const float *in, float *const *out, int channels, int64_t frames) {
+        float *left = out[0];
+        float *right = out[1];
+        int64_t i = 0;
+        for (; i + 4 <= frames; i += 4) {
+            __m128 a = _mm_loadu_ps(in + i * 2);
+            __m128 b = _mm_loadu_ps(in + i * 2 + 4);
+            _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+        float *const tail[] = { left + i, right + i };
+        scalarSplit<2>(in + i * 2, tail, channels, frames - i);
+    }
+#endif
+
+#ifdef SAMPLE_CONVERTER_AVX2
+    __attribute__((target("avx2")))
+    static inline void avx2Store(float *out, __m256i v, __m256 scale) {
+        _mm256_storeu_ps(out, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+
+    __attribute__((target("avx2")))
+    static void avx2UInt8(const unsigned char *in, float *out, int64_t count) {
+        const __m128i bias = _mm_set1_epi8(char(0x80));
+        const __m256 scale = _mm256_set1_ps(1.0f / 128.0f);
+        int64_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i b = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)), bias);
+            avx2Store(out + i, _mm256_cvtepi8_epi32(b), scale);
+            avx2Store(out + i + 8, _mm256_cvtepi8_epi32(_mm_srli_si128(b, 8)), scale);
+        }
+        scalarUInt8(in + i, out + i, count - i);
+    }
+
+    __attribute__((target("avx2")))
+    static void avx2Int16(const unsigned char *in, float *out, int64_t count) {
+        const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+        int64_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 2));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 2 + 16));
+            avx2Store(out + i, _mm256_cvtepi16_epi32(a), scale);
+            avx2Store(out + i + 8, _mm256_cvtepi16_epi32(b), scale);
+        }
+        scalarInt16(in + i * 2, out + i, count - i);
+    }
+
+    // Eight samples from two overlapping 16-byte loads, 12 bytes apart;
+    // the shuffle moves each sample's three bytes to the top of a lane
+    __attribute__((target("avx2")))
+    static void avx2Int24(const unsigned char *in, float *out, int64_t count) {
+        const __m256i shuffle = _mm256_setr_epi8(
+            -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+            -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+        const __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+        int64_t i = 0;
+        // The second load reads 4 bytes past the eighth sample, so stop
+        // while there are at least two more samples
+        for (; i + 10 <= count; i += 8) {
+            const unsigned char *p = in + i * 3;
+            __m256i v = _mm256_inserti128_si256(
+                _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))),
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 12)), 1);
+            avx2Store(out + i, _mm256_shuffle_epi8(v, shuffle), scale);
+        }
+        scalarInt24(in + i * 3, out + i, count - i);
+    }
+
+    __attribute__((target("avx2")))
+    static void avx2Int32(const unsigned char *in, float *out, int64_t count) {
+        const __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+        int64_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            avx2Store(out + i, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i * 4)), scale);
+        }
+        scalarInt32(in + i * 4, out + i, count - i);
+    }
+
+    __attribute__((target("avx2")))
+    static void avx2Float64(const unsigned char *in, float *out, int64_t count) {
+        int64_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(reinterpret_cast<const double *>(in + i * 8)));
+            __m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(reinterpret_cast<const double *>(in + i * 8 + 32)));
+            _mm256_storeu_ps(out + i, _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+        }
+        scalarFloat64(in + i * 8, out + i, count - i);
+    }
+#endif
+
+#ifdef SAMPLE_CONVERTER_NEON
+    static inline void neonStore(float *out, int32x4_t v, float scale) {
+        vst1q_f32(out, vmulq_n_f32(vcvtq_f32_s32(v), scale));
+    }
+
+    static void neonUInt8(const unsigned char *in, float *out, int64_t count) {
+        const uint8x16_t bias = vdupq_n_u8(0x80);
+        int64_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            int8x16_t b = vreinterpretq_s8_u8(veorq_u8(vld1q_u8(in + i), bias));
+            int16x8_t lo = vmovl_s8(vget_low_s8(b));
+            int16x8_t hi = vmovl_s8(vget_high_s8(b));
+            neonStore(out + i, vmovl_s16(vget_low_s16(lo)), 1.0f / 128.0f);
+            neonStore(out + i + 4, vmovl_s16(vget_high_s16(lo)), 1.0f / 128.0f);
+            neonStore(out + i + 8, vmovl_s16(vget_low_s16(hi)), 1.0f / 128.0f);
+            neonStore(out + i + 12, vmovl_s16(vget_high_s16(hi)), 1.0f / 128.0f);
+        }
+        scalarUInt8(in + i, out + i, count - i);
+    }
+
+    static void neonInt16(const unsigned char *in, float *out, int64_t count) {
+        int64_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            int16x8_t v = vreinterpretq_s16_u8(vld1q_u8(in + i * 2));
+            neonStore(out + i, vmovl_s16(vget_low_s16(v)), 1.0f / 32768.0f);
+            neonStore(out + i + 4, vmovl_s16(vget_high_s16(v)), 1.0f / 32768.0f);
+        }
+        scalarInt16(in + i * 2, out + i, count - i);
+    }
+
+    // vld3 splits eight samples into their low, middle and high bytes
+    static void neonInt24(const unsigned char *in, float *out, int64_t count) {
+        int64_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            uint8x8x3_t b = vld3_u8(in + i * 3);
+            uint16x8_t low = vshll_n_u8(b.val[0], 8);
+            uint16x8_t high = vorrq_u16(vmovl_u8(b.val[1]), vshll_n_u8(b.val[2], 8));
+            uint32x4_t v0 = vorrq_u32(vmovl_u16(vget_low_u16(low)), vshll_n_u16(vget_low_u16(high), 16));
+            uint32x4_t v1 = vorrq_u32(vmovl_u16(vget_high_u16(low)), vshll_n_u16(vget_high_u16(high), 16));
+            neonStore(out + i, vreinterpretq_s32_u32(v0), 1.0f / 2147483648.0f);
+            neonStore(out + i + 4, vreinterpretq_s32_u32(v1), 1.0f / 2147483648.0f);
+        }
+        scalarInt24(in + i * 3, out + i, count - i);
+    }
+
+    static void neonInt32(const unsigned char *in, float *out, int64_t count) {
+        int64_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            neonStore(out + i, vreinterpretq_s32_u8(vld1q_u8(in + i * 4)), 1.0f / 2147483648.0f);
+        }
+        scalarInt32(in + i * 4, out + i, count - i);
+    }
+
+    static void neonFloat64(const unsigned char *in, float *out, int64_t count) {
+        int64_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            float64x2_t lo = vreinterpretq_f64_u8(vld1q_u8(in + i * 8));
+            float64x2_t hi = vreinterpretq_f64_u8(vld1q_u8(in + i * 8 + 16));
+            vst1q_f32(out + i, vcombine_f32(vcvt_f32_f64(lo), vcvt_f32_f64(hi)));
+        }
+        scalarFloat64(in + i * 8, out + i, count - i);
+    }
+
+    // vld2 de-interleaves four stereo frames by itself
+    static void neonSplit2(const float *in, float *const *out, int channels, int64_t frames) {
+        float *left = out[0];
+        float *right = out[1];
+        int64_t i = 0;
+        for (; i + 4 <= frames; i += 4) {
+            float32x4x2_t v = vld2q_f32(in + i * 2);
+            vst1q_f32(left + i, v.val[0]);
+            vst1q_f32(right + i, v.val[1]);
+        }
+        float *const tail[] = { left + i, right + i };
+        scalarSplit<2>(in + i * 2, tail, channels, frames - i);
+    }
+#endif
+};
+
+#endif
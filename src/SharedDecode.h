@@ -0,0 +1,217 @@
+#ifndef SHARED_DECODE_H
+#define SHARED_DECODE_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+#include "AudioSource.h"
+
+// One sequential decode of a source, shared by several readers on
+// their own threads, each taking some of its channels.
+//
+// The source is decoded in slabs of SlabFrames frames by whichever
+// reader first needs one, and each slab is dropped as soon as every
+// reader has passed it. A reader more than MaxSlabs slabs ahead of the
+// slowest waits for it to catch up, so memory stays bounded however
+// unevenly the readers progress. Every reader must therefore keep
+// reading until it calls release(), and all of them must be running at
+// once.
+//
+// Input already in memory (see AudioSource::view()) is not decoded at
+// all; readers are handed pointers into it.
+class SharedDecode {
+public:
+    static const int64_t SlabFrames = 65536;
+    static const int MaxSlabs = 8;
+
+    // Read source from its current position, which becomes frame 0
+    SharedDecode(AudioSource &source, int readers) :
+        m_source(source),
+        m_channels(source.channels()),
+        m_frames(source.frames() - source.position()),
+        m_positions(readers, 0),
+        m_view(source.channels()),
+        m_viewFrames(0),
+        m_viewing(false),
+        m_decodedEnd(0),
+        m_finished(false),
+        m_decoding(false),
+        m_cancelled(false) {
+        m_viewing = source.view(m_view.data(), m_viewFrames);
+    }
+
+    int channels() const { return m_channels; }
+    int sampleRate() const { return m_source.sampleRate(); }
+    int64_t frames() const { return m_frames; }
+
+    // Point channels[i] at the in-memory frames of the source from frame
+    // onwards for each of the given channels, if the source has them
+    bool view(const std::vector<int> &which, int64_t frame,
+              const float **channels, int64_t &frames) const {
+        if (!m_viewing) return false;
+        for (size_t i = 0; i < which.size(); ++i) {
+            channels[i] = m_view[which[i]] + frame;
+        }
+        frames = m_viewFrames - frame;
+        return true;
+    }
+
+    // Copy up to n frames of the given channels, starting at frame from,
+    // into dest[i] for which[i], for a reader that has not yet read past
+    // from. Returns fewer than n only at the end of the source.
+    int64_t read(int reader, const std::vector<int> &which,
+                 float *const *dest, int64_t from, int64_t n) {
+        int64_t done = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (done < n) {
+            const int64_t frame = from + done;
+            while (frame >= m_decodedEnd && !m_finished && !m_cancelled) {
+                if (m_decoding || m_decodedEnd - slowest() >= MaxSlabs * SlabFrames) {
+                    m_changed.wait(lock);
+                    continue;
+                }
+                decodeSlab(lock);
+            }
+            if (m_cancelled || frame >= m_decodedEnd) break;
+
+            // Slabs at or after this reader's position are never
+            // dropped, and the deque keeps them in place as others
+            // are added, so they can be copied from without the lock
+            const Slab &slab = m_slabs[size_t((frame - m_slabs.front().start) / SlabFrames)];
+            const int64_t count = std::min(n - done, slab.start + slab.frames - frame);
+            lock.unlock();
+            for (size_t i = 0; i < which.size(); ++i) {
+                const float *src = slab.data[which[i]].data() + (frame - slab.start);
+                std::copy(src, src + count, dest[i] + done);
+            }
+            lock.lock();
+            done += count;
+            advance(reader, from + done);
+        }
+        return done;
+    }
+
+    // Mark a reader as finished, so it holds nothing back
+    void release(int reader) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        advance(reader, std::numeric_limits<int64_t>::max());
+    }
+
+    // End the input early for every reader, waking any that are waiting
+    void cancel() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancelled = true;
+        m_changed.notify_all();
+    }
+
+private:
+    struct Slab {
+        int64_t start;
+        int64_t frames;
+        std::vector<std::vector<float> > data;
+    };
+
+    AudioSource &m_source;
+    int m_channels;
+    int64_t m_frames;
+    std::vector<int64_t> m_positions;
+    std::vector<const float *> m_view;
+    int64_t m_viewFrames;
+    bool m_viewing;
+
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::deque<Slab> m_slabs;
+    std::vector<Slab> m_spare;
+    int64_t m_decodedEnd;
+    bool m_finished;
+    bool m_decoding;
+    bool m_cancelled;
+
+    int64_t slowest() const {
+        return *std::min_element(m_positions.begin(), m_positions.end());
+    }
+
+    // Record that a reader has read up to frame, and drop the slabs
+    // that no reader needs any more
+    void advance(int reader, int64_t frame) {
+        m_positions[reader] = std::max(m_positions[reader], frame);
+        const int64_t first = slowest();
+        while (!m_slabs.empty() && m_slabs.front().start + m_slabs.front().frames <= first) {
+            if (int(m_spare.size()) < MaxSlabs) m_spare.push_back(std::move(m_slabs.front()));
+            m_slabs.pop_front();
+        }
+        m_changed.notify_all();
+    }
+
+    // Decode the next slab with the lock released, so other readers can
+    // go on copying from the slabs already decoded
+    void decodeSlab(std::unique_lock<std::mutex> &lock) {
+        m_decoding = true;
+        Slab slab;
+        if (!m_spare.empty()) {
+            slab = std::move(m_spare.back());
+            m_spare.pop_back();
+        }
+        slab.start = m_decodedEnd;
+        lock.unlock();
+
+        slab.data.resize(m_channels);
+        std::vector<float *> dest(m_channels);
+        for (int c = 0; c < m_channels; ++c) {
+            slab.data[c].resize(SlabFrames);
+            dest[c] = slab.data[c].data();
+        }
+        slab.frames = m_source.read(dest.data(), SlabFrames);
+
+        lock.lock();
+        m_decoding = false;
+        if (slab.frames < SlabFrames) m_finished = true;
+        if (slab.frames > 0) {
+            m_decodedEnd += slab.frames;
+            m_slabs.push_back(std::move(slab));
+        }
+        m_changed.notify_all();
+    }
+};
+
+// The given channels of a SharedDecode, read by one of its readers
+class SharedChannelSource : public AudioSource {
+public:
+    SharedChannelSource(SharedDecode &shared, int reader, const std::vector<int> &which) :
+        m_shared(shared), m_reader(reader), m_which(which), m_position(0) {}
+
+    int channels() const { return int(m_which.size()); }
+    int sampleRate() const { return m_shared.sampleRate(); }
+    int64_t frames() const { return m_shared.frames(); }
+
+    int64_t read(float *const *dest, int64_t n) {
+        int64_t got = m_shared.read(m_reader, m_which, dest, m_position, n);
+        m_position += got;
+        return got;
+    }
+
+    // Only ever read forwards
+    bool seek(int64_t frame) { return frame == m_position; }
+
+    int64_t position() const { return m_position; }
+
+    bool view(const float **channels, int64_t &frames) const {
+        return m_shared.view(m_which, m_position, channels, frames);
+    }
+
+    std::unique_ptr<AudioSource> clone() const { return nullptr; }
+
+private:
+    SharedDecode &m_shared;
+    int m_reader;
+    std::vector<int> m_which;
+    int64_t m_position;
+};
+
+#endif
@@ -0,0 +1,193 @@
+#ifndef SILENCE_GATE_H
+#define SILENCE_GATE_H
+
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+// Decides, block by block, whether a plugin needs to see the input at
+// all, so that long stretches of background noise in sparse recordings
+// can be skipped.
+//
+// A block is active if its level is at least the threshold; the level
+// is the mean square of all its channels in dB relative to full scale,
+// taken after a high-pass filter at the floor frequency if one is set.
+// Blocks are processed while active and for the hangover after the
+// start of the last active block, and skipped otherwise.
+//
+// The most recent skipped blocks, up to the warm-up length, are held so
+// that when processing resumes the plugin can be reset and given them
+// first, to settle before the audio that matters. The stretches that
+// were skipped are recorded as ranges of block start frames.
+class SilenceGate {
+public:
+    enum Decision {
+        Process, // process the block, as the one before it
+        Resume,  // process the block after skipping: reset and warm up first
+        Pause,   // skip the block after processing: collect what remains
+        Skip     // skip the block, as the one before it
+    };
+
+    struct Range {
+        int64_t start;
+        int64_t end;
+    };
+
+    struct Held {
+        int64_t start;
+        std::vector<std::vector<float> > channels;
+        std::vector<const float *> pointers;
+    };
+
+    SilenceGate(int sampleRate, int channels, int blockSize, int stepSize,
+                double thresholdDb, double floorHz,
+                int64_t hangoverFrames, int64_t warmupFrames) :
+        m_channels(channels),
+        m_blockSize(blockSize),
+        m_threshold(thresholdDb),
+        m_hangover(hangoverFrames),
+        m_warmupBlocks(size_t((warmupFrames + stepSize - 1) / stepSize)),
+        m_highPass(floorHz > 0 && floorHz < sampleRate / 2.0),
+        m_b0(1), m_b1(0), m_b2(0), m_a1(0), m_a2(0),
+        m_processing(false),
+        m_active(false),
+        m_lastActive(0),
+        m_resumed(false) {
+        if (m_highPass) {
+            // Second-order Butterworth high-pass, by the bilinear transform
+            const double pi = 3.14159265358979323846;
+            const double k = std::tan(pi * floorHz / sampleRate);
+            const double q = std::sqrt(2.0);
+            const double norm = 1.0 / (1.0 + q * k + k * k);
+            m_b0 = norm;
+            m_b1 = -2.0 * norm;
+            m_b2 = norm;
+            m_a1 = 2.0 * (k * k - 1.0) * norm;
+            m_a2 = (1.0 - q * k + k * k) * norm;
+        }
+    }
+
+    // Level of a block in dB relative to full scale. The high-pass
+    // filter starts from rest at each block, so the floor should be well
+    // above the block rate.
+    double level(const float *const *block) const {
+        double sum = 0;
+        for (int c = 0; c < m_channels; ++c) {
+            const float *x = block[c];
+            if (m_highPass) {
+                double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+                for (int i = 0; i < m_blockSize; ++i) {
+                    double y = m_b0 * x[i] + m_b1 * x1 + m_b2 * x2 - m_a1 * y1 - m_a2 * y2;
+                    x2 = x1; x1 = x[i];
+                    y2 = y1; y1 = y;
+                    sum += y * y;
+                }
+            } else {
+                float partial = 0.f;
+                for (int i = 0; i < m_blockSize; ++i) {
+                    partial += x[i] * x[i];
+                }
+                sum += partial;
+            }
+        }
+        double meanSquare = sum / (double(m_blockSize) * m_channels);
+        return meanSquare > 0 ? 10.0 * std::log10(meanSquare) : -HUGE_VAL;
+    }
+
+    // Decide what to do with the block starting at frame start. Skipped
+    // blocks are held for warm-up; after Resume, the held blocks are
+    // returned by held() until the next decision.
+    Decision decide(const float *const *block, int64_t start) {
+        if (m_resumed) {
+            m_spare.insert(m_spare.end(), std::make_move_iterator(m_held.begin()),
+                           std::make_move_iterator(m_held.end()));
+            m_held.clear();
+            m_resumed = false;
+        }
+
+        if (level(block) >= m_threshold) {
+            m_active = true;
+            m_lastActive = start;
+        }
+        bool process = m_active && start - m_lastActive <= m_hangover;
+
+        if (process) {
+            if (m_processing) return Process;
+            m_processing = true;
+            if (!m_skipped.empty() && m_skipped.back().end < 0) {
+                m_skipped.back().end = start;
+            }
+            m_resumed = true;
+            return Resume;
+        }
+
+        hold(block, start);
+        if (m_skipped.empty() || m_skipped.back().end >= 0) {
+            Range range;
+            range.start = start;
+            range.end = -1;
+            m_skipped.push_back(range);
+        }
+        if (!m_processing) return Skip;
+        m_processing = false;
+        return Pause;
+    }
+
+    // The blocks to warm the plugin up with on Resume, oldest first
+    const std::deque<Held> &held() const { return m_held; }
+
+    // Whether the last block was processed
+    bool processing() const { return m_processing; }
+
+    // Close any range still being skipped at frame end, at the end of
+    // the input
+    void finish(int64_t end) {
+        if (!m_skipped.empty() && m_skipped.back().end < 0) {
+            m_skipped.back().end = std::max(end, m_skipped.back().start);
+        }
+    }
+
+    // The ranges of block start frames that were skipped
+    const std::vector<Range> &skipped() const { return m_skipped; }
+
+private:
+    int m_channels;
+    int m_blockSize;
+    double m_threshold;
+    int64_t m_hangover;
+    size_t m_warmupBlocks;
+    bool m_highPass;
+    double m_b0, m_b1, m_b2, m_a1, m_a2;
+
+    bool m_processing;
+    bool m_active;       // whether any block has been active yet
+    int64_t m_lastActive;
+    bool m_resumed;
+    std::deque<Held> m_held;
+    std::vector<Held> m_spare;
+    std::vector<Range> m_skipped;
+
+    void hold(const float *const *block, int64_t start) {
+        if (m_warmupBlocks == 0) return;
+        Held held;
+        if (m_held.size() >= m_warmupBlocks) {
+            held = std::move(m_held.front());
+            m_held.pop_front();
+        } else if (!m_spare.empty()) {
+            held = std::move(m_spare.back());
+            m_spare.pop_back();
+        }
+        held.start = start;
+        held.channels.resize(m_channels);
+        held.pointers.resize(m_channels);
+        for (int c = 0; c < m_channels; ++c) {
+            held.channels[c].assign(block[c], block[c] + m_blockSize);
+            held.pointers[c] = held.channels[c].data();
+        }
+        m_held.push_back(std::move(held));
+    }
+};
+
+#endif
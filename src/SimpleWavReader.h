@@ -4,161 +4,340 @@
 #include <string>
 #include <vector>
 #include <fstream>
-// #include <iostream>
 #include <cstring>
 #include <algorithm>
 #include <cstdint>
-#include <Rcpp.h>
 
+#include "MappedFile.h"
+#include "SampleConverter.h"
+
+// Reads PCM / IEEE float WAV files, including RF64 and BW64 files, whose
+// ds64 chunk carries the 64-bit sizes of data chunks over 4 GB.
+//
+// Samples are converted to float by the SampleConverter kernels for the
+// file's encoding, vectorised where the CPU allows.
+//
+// open() + readPlanar() streams the data chunk so that only the frames
+// currently requested are decoded. Streaming keeps memory bounded by the
+// request size regardless of the length of the file.
+//
+// Where the file can be memory-mapped, frames are converted straight
+// from the mapping, with no read buffer in between; for mono 32-bit float
+// files view() exposes the samples in place, so they need not be copied
+// at all. Otherwise the data chunk is read through a stream.
 class SimpleWavReader {
 public:
     struct Header {
         uint16_t channels;
         uint32_t sampleRate;
         uint16_t bitsPerSample;
-        uint32_t dataSize; // in bytes
+        uint64_t dataSize; // in bytes
         uint16_t audioFormat; // 1 = PCM, 3 = IEEE Float
     };
 
-    static bool read(const std::string& filename, std::vector<float>& data, Header& header) {
-        std::ifstream file(filename, std::ios::binary);
-        if (!file.is_open()) {
-            Rcpp::Rcerr << "Failed to open file: " << filename << "\n";
-            return false;
+    SimpleWavReader() : m_header(), m_frameBytes(0), m_frames(0), m_position(0), m_dataStart(0),
+                        m_kernel(nullptr), m_split(nullptr) {}
+
+    // Parse the RIFF headers and position the stream at the start of the
+    // data chunk. On failure returns false and error() describes why.
+    // With mapData false the file is never mapped, so opening it touches
+    // only the headers, as when probing many files.
+    bool open(const std::string& filename, bool mapData = true) {
+        m_file.close();
+        m_file.clear();
+        m_map.close();
+        m_error.clear();
+        m_header = Header();
+        m_frameBytes = 0;
+        m_frames = 0;
+        m_position = 0;
+        m_dataStart = 0;
+
+        m_file.open(filename, std::ios::binary);
+        if (!m_file.is_open()) {
+            return fail("Failed to open file: " + filename);
         }
 
         char chunkId[4];
-        file.read(chunkId, 4);
-        if (std::strncmp(chunkId, "RIFF", 4) != 0) {
-             Rcpp::Rcerr << "Not a RIFF file" << "\n";
-             return false;
+        m_file.read(chunkId, 4);
+        if (!m_file) {
+             return fail("Not a RIFF file");
+        }
+        const bool rf64 = std::strncmp(chunkId, "RF64", 4) == 0 ||
+            std::strncmp(chunkId, "BW64", 4) == 0;
+        if (!rf64 && std::strncmp(chunkId, "RIFF", 4) != 0) {
+             return fail("Not a RIFF file");
         }
 
         uint32_t riffSize;
-        file.read(reinterpret_cast<char*>(&riffSize), 4);
+        m_file.read(reinterpret_cast<char*>(&riffSize), 4);
 
         char format[4];
-        file.read(format, 4);
-        if (std::strncmp(format, "WAVE", 4) != 0) {
-             Rcpp::Rcerr << "Not a WAVE file" << "\n";
-             return false;
+        m_file.read(format, 4);
+        if (!m_file || std::strncmp(format, "WAVE", 4) != 0) {
+             return fail("Not a WAVE file");
         }
 
         bool fmtFound = false;
-        bool dataFound = false;
-
-        while (file.read(chunkId, 4)) {
-            uint32_t chunkSize;
-            file.read(reinterpret_cast<char*>(&chunkSize), 4);
-            
-            // Rcpp::Rcerr << "Chunk: " << std::string(chunkId, 4) << " Size: " << chunkSize << std::endl;
-
-            if (std::strncmp(chunkId, "fmt ", 4) == 0) {
-                file.read(reinterpret_cast<char*>(&header.audioFormat), 2);
-                file.read(reinterpret_cast<char*>(&header.channels), 2);
-                file.read(reinterpret_cast<char*>(&header.sampleRate), 4);
+
+        // 64-bit chunk sizes from the ds64 chunk, by chunk id, for the
+        // chunks whose 32-bit size is 0xFFFFFFFF
+        std::vector<std::pair<std::string, uint64_t> > sizes64;
+
+        while (m_file.read(chunkId, 4)) {
+            uint32_t chunkSize32;
+            m_file.read(reinterpret_cast<char*>(&chunkSize32), 4);
+            uint64_t chunkSize = chunkSize32;
+            if (rf64 && chunkSize32 == 0xFFFFFFFF) {
+                for (size_t i = 0; i < sizes64.size(); ++i) {
+                    if (sizes64[i].first == std::string(chunkId, 4)) chunkSize = sizes64[i].second;
+                }
+            }
+
+            if (rf64 && std::strncmp(chunkId, "ds64", 4) == 0) {
+                uint64_t riffSize64, dataSize64, sampleCount64;
+                uint32_t tableLength;
+                m_file.read(reinterpret_cast<char*>(&riffSize64), 8);
+                m_file.read(reinterpret_cast<char*>(&dataSize64), 8);
+                m_file.read(reinterpret_cast<char*>(&sampleCount64), 8);
+                m_file.read(reinterpret_cast<char*>(&tableLength), 4);
+                if (!m_file || chunkSize < 28) {
+                    return fail("Invalid ds64 chunk");
+                }
+                sizes64.push_back(std::make_pair(std::string("data"), dataSize64));
+                uint64_t bytesRead = 28;
+                for (uint32_t i = 0; i < tableLength && bytesRead + 12 <= chunkSize; ++i) {
+                    char id[4];
+                    uint64_t size;
+                    m_file.read(id, 4);
+                    m_file.read(reinterpret_cast<char*>(&size), 8);
+                    sizes64.push_back(std::make_pair(std::string(id, 4), size));
+                    bytesRead += 12;
+                }
+                m_file.seekg(std::streamoff(chunkSize - bytesRead + (chunkSize & 1)), std::ios::cur);
+            } else if (std::strncmp(chunkId, "fmt ", 4) == 0) {
+                m_file.read(reinterpret_cast<char*>(&m_header.audioFormat), 2);
+                m_file.read(reinterpret_cast<char*>(&m_header.channels), 2);
+                m_file.read(reinterpret_cast<char*>(&m_header.sampleRate), 4);
                 uint32_t byteRate;
-                file.read(reinterpret_cast<char*>(&byteRate), 4);
+                m_file.read(reinterpret_cast<char*>(&byteRate), 4);
                 uint16_t blockAlign;
-                file.read(reinterpret_cast<char*>(&blockAlign), 2);
-                file.read(reinterpret_cast<char*>(&header.bitsPerSample), 2);
-                
+                m_file.read(reinterpret_cast<char*>(&blockAlign), 2);
+                m_file.read(reinterpret_cast<char*>(&m_header.bitsPerSample), 2);
+
                 // Handle WAVE_FORMAT_EXTENSIBLE (65534)
                 uint32_t bytesRead = 16;
-                if (header.audioFormat == 65534) {
+                if (m_header.audioFormat == 65534) {
                     uint16_t cbSize;
-                    file.read(reinterpret_cast<char*>(&cbSize), 2);
+                    m_file.read(reinterpret_cast<char*>(&cbSize), 2);
                     bytesRead += 2;
-                    
+
                     if (cbSize >= 22) {
                         uint16_t validBitsPerSample;
-                        file.read(reinterpret_cast<char*>(&validBitsPerSample), 2);
+                        m_file.read(reinterpret_cast<char*>(&validBitsPerSample), 2);
                         uint32_t dwChannelMask;
-                        file.read(reinterpret_cast<char*>(&dwChannelMask), 4);
-                        
+                        m_file.read(reinterpret_cast<char*>(&dwChannelMask), 4);
+
                         // Read SubFormat GUID (16 bytes)
                         // The first 2 bytes of the GUID match the standard PCM/Float codes
                         uint16_t subFormatCode;
-                        file.read(reinterpret_cast<char*>(&subFormatCode), 2);
-                        
+                        m_file.read(reinterpret_cast<char*>(&subFormatCode), 2);
+
                         // Skip the rest of the GUID (14 bytes)
-                        file.seekg(14, std::ios::cur);
-                        
+                        m_file.seekg(14, std::ios::cur);
+
                         // Update audioFormat to the actual underlying format
-                        header.audioFormat = subFormatCode;
+                        m_header.audioFormat = subFormatCode;
                         bytesRead += 22;
                     }
                 }
 
-                // Rcpp::Rcerr << "Format: " << header.audioFormat << " Channels: " << header.channels << " Rate: " << header.sampleRate << " Bits: " << header.bitsPerSample << std::endl;
-
                 if (chunkSize > bytesRead) {
-                    file.seekg(chunkSize - bytesRead, std::ios::cur);
+                    m_file.seekg(std::streamoff(chunkSize - bytesRead), std::ios::cur);
                 }
                 fmtFound = true;
             } else if (std::strncmp(chunkId, "data", 4) == 0) {
                 if (!fmtFound) {
-                     Rcpp::Rcerr << "data chunk before fmt chunk" << "\n";
-                     return false; 
+                     return fail("data chunk before fmt chunk");
                 }
-
-                header.dataSize = chunkSize;
-                int numSamples = header.dataSize / (header.bitsPerSample / 8);
-                data.resize(numSamples);
-
-                if (header.audioFormat == 1) { // PCM
-                    if (header.bitsPerSample == 16) {
-                        std::vector<int16_t> buffer(numSamples);
-                        file.read(reinterpret_cast<char*>(buffer.data()), header.dataSize);
-                        for (int i = 0; i < numSamples; ++i) {
-                            data[i] = buffer[i] / 32768.0f;
-                        }
-                    } else if (header.bitsPerSample == 8) {
-                        std::vector<uint8_t> buffer(numSamples);
-                        file.read(reinterpret_cast<char*>(buffer.data()), header.dataSize);
-                        for (int i = 0; i < numSamples; ++i) {
-                            data[i] = (buffer[i] - 128) / 128.0f;
-                        }
-                    } else if (header.bitsPerSample == 24) {
-                         // 24-bit is tricky (3 bytes). 
-                         // Read 3 bytes at a time.
-                         uint8_t buf[3];
-                         for (int i = 0; i < numSamples; ++i) {
-                             file.read(reinterpret_cast<char*>(buf), 3);
-                             int32_t val = (buf[0]) | (buf[1] << 8) | (buf[2] << 16);
-                             if (val & 0x800000) val |= 0xFF000000; // Sign extend
-                             data[i] = val / 8388608.0f;
-                         }
-                    } else if (header.bitsPerSample == 32) {
-                        std::vector<int32_t> buffer(numSamples);
-                        file.read(reinterpret_cast<char*>(buffer.data()), header.dataSize);
-                        for (int i = 0; i < numSamples; ++i) {
-                            data[i] = buffer[i] / 2147483648.0f;
-                        }
-                    } else {
-                         Rcpp::Rcerr << "Unsupported PCM bit depth: " << header.bitsPerSample << "\n";
-                         return false;
-                    }
-                } else if (header.audioFormat == 3) { // IEEE Float
-                    if (header.bitsPerSample == 32) {
-                        file.read(reinterpret_cast<char*>(data.data()), header.dataSize);
-                    } else {
-                        Rcpp::Rcerr << "Unsupported float bit depth: " << header.bitsPerSample << "\n";
-                        return false;
-                    }
+                m_header.dataSize = chunkSize;
+                m_dataStart = m_file.tellg();
+                if (!checkFormat()) return false;
+                if (mapData && m_map.open(filename) && uint64_t(m_dataStart) <= m_map.size()) {
+                    m_file.close();
                 } else {
-                    Rcpp::Rcerr << "Unsupported audio format: " << header.audioFormat << "\n";
-                    return false;
+                    m_map.close();
                 }
-                dataFound = true;
-                break; // Stop after reading data
+                return true;
             } else {
-                // Rcpp::Rcerr << "Skipping chunk: " << std::string(chunkId, 4) << std::endl;
-                file.seekg(chunkSize + (chunkSize & 1), std::ios::cur);
+                m_file.seekg(std::streamoff(chunkSize + (chunkSize & 1)), std::ios::cur);
+            }
+        }
+        return fail("No data chunk found");
+    }
+
+    const Header& header() const { return m_header; }
+
+    // Number of sample frames (one sample per channel) in the data chunk
+    int64_t frames() const { return m_frames; }
+
+    // Frame index of the next frame returned by readPlanar()
+    int64_t position() const { return m_position; }
+
+    const std::string& error() const { return m_error; }
+
+    // True if frames are read from a memory mapping of the file
+    bool mapped() const { return m_map.isOpen(); }
+
+    // Position the stream so that the next read starts at the given frame
+    bool seek(int64_t frame) {
+        if (frame < 0 || frame > m_frames) return false;
+        if (m_map.isOpen()) {
+            m_position = frame;
+            return true;
+        }
+        if (!m_file.is_open()) return false;
+        m_file.clear();
+        m_file.seekg(m_dataStart + frame * m_frameBytes, std::ios::beg);
+        if (!m_file) return false;
+        m_position = frame;
+        return true;
+    }
+
+    // Decode up to n frames into one buffer per channel, dest[c] holding
+    // n floats for channel c, de-interleaving while converting so each
+    // sample is written exactly once. Returns the number of frames
+    // decoded, which is less than n only at the end of the data chunk or
+    // if the file is truncated.
+    int64_t readPlanar(float* const* dest, int64_t n) {
+        n = std::max<int64_t>(0, std::min(n, m_frames - m_position));
+        const int channels = m_header.channels;
+        if (m_map.isOpen()) {
+            n = std::min(n, mappedFrames() - m_position);
+            if (n <= 0) return 0;
+            convertPlanar(mappedData(), dest, n);
+            m_position += n;
+            return n;
+        }
+        if (n == 0 || !m_file) return 0;
+
+        const int64_t bytes = n * m_frameBytes;
+        int64_t got;
+        if (isFloat32() && channels == 1) {
+            m_file.read(reinterpret_cast<char*>(dest[0]), bytes);
+            got = m_file.gcount() / m_frameBytes;
+        } else {
+            if (static_cast<int64_t>(m_raw.size()) < bytes) m_raw.resize(bytes);
+            m_file.read(m_raw.data(), bytes);
+            got = m_file.gcount() / m_frameBytes;
+            convertPlanar(reinterpret_cast<const unsigned char*>(m_raw.data()), dest, got);
+        }
+        m_position += got;
+        return got;
+    }
+
+    // For a mapped mono 32-bit float file, point channels[0] at the
+    // samples from position() onwards, in place in the mapping, and set
+    // frames to how many there are. Returns false for any other file.
+    bool view(const float** channels, int64_t& frames) const {
+        if (!m_map.isOpen() || !isFloat32() || m_header.channels != 1) {
+            return false;
+        }
+        const unsigned char* data = mappedData();
+        if (reinterpret_cast<uintptr_t>(data) % alignof(float) != 0) return false;
+        channels[0] = reinterpret_cast<const float*>(data);
+        frames = std::max<int64_t>(0, std::min(m_frames, mappedFrames()) - m_position);
+        return true;
+    }
+
+private:
+    std::ifstream m_file;
+    Header m_header;
+    int m_frameBytes;
+    int64_t m_frames;
+    int64_t m_position;
+    std::streamoff m_dataStart; // byte offset of the first frame
+    std::vector<char> m_raw;
+    std::vector<float> m_scratch;
+    SampleConverter::Kernel m_kernel;
+    SampleConverter::Splitter m_split;
+    std::vector<float*> m_splitDest;
+    MappedFile m_map;
+    std::string m_error;
+
+    // Frames present in the mapping, fewer than m_frames if the file is
+    // truncated
+    int64_t mappedFrames() const {
+        return int64_t((m_map.size() - uint64_t(m_dataStart)) / m_frameBytes);
+    }
+
+    // Mapped bytes of the frame at m_position
+    const unsigned char* mappedData() const {
+        return m_map.data() + m_dataStart + m_position * m_frameBytes;
+    }
+
+    bool isFloat32() const {
+        return m_header.audioFormat == 3 && m_header.bitsPerSample == 32;
+    }
+
+    bool fail(const std::string& message) {
+        m_error = message;
+        m_file.close();
+        m_map.close();
+        return false;
+    }
+
+    bool checkFormat() {
+        if (m_header.audioFormat == 1) { // PCM
+            if (m_header.bitsPerSample != 8 && m_header.bitsPerSample != 16 &&
+                m_header.bitsPerSample != 24 && m_header.bitsPerSample != 32) {
+                return fail("Unsupported PCM bit depth: " + std::to_string(m_header.bitsPerSample));
+            }
+        } else if (m_header.audioFormat == 3) { // IEEE Float
+            if (m_header.bitsPerSample != 32 && m_header.bitsPerSample != 64) {
+                return fail("Unsupported float bit depth: " + std::to_string(m_header.bitsPerSample));
+            }
+        } else {
+            return fail("Unsupported audio format: " + std::to_string(m_header.audioFormat));
+        }
+        if (m_header.channels == 0) {
+            return fail("WAV file has no channels");
+        }
+        SampleConverter::Encoding encoding = SampleConverter::Int16;
+        if (!SampleConverter::encoding(m_header.audioFormat, m_header.bitsPerSample, encoding)) {
+            return fail("Unsupported WAV encoding: format " + std::to_string(m_header.audioFormat) +
+                        ", " + std::to_string(m_header.bitsPerSample) + " bits");
+        }
+        m_kernel = SampleConverter::kernel(encoding);
+        m_split = SampleConverter::splitter(m_header.channels);
+        m_splitDest.resize(m_header.channels);
+        m_frameBytes = m_header.channels * (m_header.bitsPerSample / 8);
+        m_frames = static_cast<int64_t>(m_header.dataSize / m_frameBytes);
+        return true;
+    }
+
+    // Convert n interleaved frames into one buffer per channel. Multiple
+    // channels go through a scratch buffer of a few thousand samples, so
+    // the conversion itself always runs over contiguous samples, and are
+    // then split by the splitter picked for the channel count at open.
+    void convertPlanar(const unsigned char* raw, float* const* dest, int64_t n) {
+        const int channels = m_header.channels;
+        if (channels == 1) {
+            m_kernel(raw, dest[0], n);
+            return;
+        }
+        const int64_t chunk = std::max<int64_t>(1, 4096 / channels);
+        if (static_cast<int64_t>(m_scratch.size()) < chunk * channels) {
+            m_scratch.resize(chunk * channels);
+        }
+        for (int64_t done = 0; done < n; done += chunk) {
+            const int64_t count = std::min(chunk, n - done);
+            m_kernel(raw + done * m_frameBytes, m_scratch.data(), count * channels);
+            for (int c = 0; c < channels; ++c) {
+                m_splitDest[c] = dest[c] + done;
             }
+            m_split(m_scratch.data(), m_splitDest.data(), channels, count);
         }
-        if (!dataFound) Rcpp::Rcerr << "No data chunk found" << "\n";
-        return dataFound;
     }
 };
 
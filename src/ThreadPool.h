@@ -0,0 +1,127 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+
+// Fixed set of worker threads running queued tasks.
+//
+// Tasks must not touch R: no Rcpp objects, no R API calls, no
+// Rcpp::Rcerr, and nothing that can call Rcpp::stop(). That includes
+// loading or deleting plugins, which updates the PluginLoader, so those
+// stay on the main thread. Tasks must catch their own exceptions.
+// Destroying the pool discards tasks not yet started and joins the
+// workers once their current task finishes.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads) : m_stopping(false), m_active(0) {
+        threads = std::max(1, threads);
+        for (int i = 0; i < threads; ++i) {
+            m_workers.push_back(std::thread(&ThreadPool::work, this));
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+            m_tasks.clear();
+        }
+        m_wake.notify_all();
+        for (size_t i = 0; i < m_workers.size(); ++i) {
+            m_workers[i].join();
+        }
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(task);
+        }
+        m_wake.notify_one();
+    }
+
+    // Block until every submitted task has finished
+    void wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle.wait(lock, [this] { return m_tasks.empty() && m_active == 0; });
+    }
+
+    int size() const { return int(m_workers.size()); }
+
+    // Worker count for a user-supplied thread count, where zero or less
+    // means one per hardware thread
+    static int threadCount(int requested) {
+        if (requested > 0) return requested;
+        int hardware = int(std::thread::hardware_concurrency());
+        return hardware > 0 ? hardware : 1;
+    }
+
+private:
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    bool m_stopping;
+    int m_active;
+
+    void work() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+                if (m_stopping) return;
+                task = m_tasks.front();
+                m_tasks.pop_front();
+                ++m_active;
+            }
+            task();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_active;
+            }
+            m_idle.notify_all();
+        }
+    }
+};
+
+// Indices of finished tasks, handed back to the main thread so that it
+// can convert results to R objects as they arrive
+class CompletionQueue {
+public:
+    void push(int index) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done.push_back(index);
+        }
+        m_ready.notify_one();
+    }
+
+    // Wait up to timeoutMs for a finished index. Returns false on
+    // timeout, so the caller can check for a user interrupt.
+    bool pop(int &index, int timeoutMs) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_ready.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                              [this] { return !m_done.empty(); })) {
+            return false;
+        }
+        index = m_done.front();
+        m_done.pop_front();
+        return true;
+    }
+
+private:
+    std::deque<int> m_done;
+    std::mutex m_mutex;
+    std::condition_variable m_ready;
+};
+
+#endif